@@ -67,7 +67,7 @@ int main(int argc, char** argv){
   for(auto t : domain->getLinearizedIndexSpace()){
     printf("Timestep %f\n", t);
 
-    auto& grid = root_group->getGroup(t_count++);
+    auto grid = root_group->getGroup(t_count++);
     std::shared_ptr<Domain> domain = grid->getDomain();
     
     printf("\tGrid Domain[%s]:\n", Domain::toString(domain->getType()));
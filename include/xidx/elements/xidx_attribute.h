@@ -48,23 +48,25 @@ public:
   { name=_name; value=_value; };
 
   std::string value;
+  
+  int setValue(std::string _value){ value = _value; markModified(); return 0; }
 
-  xmlNodePtr serialize(xmlNode *parent, const char *text = NULL) override{
-    xmlNodePtr att_node = xmlNewChild(parent, NULL, BAD_CAST "Attribute", BAD_CAST text);
-    xmlNewProp(att_node, BAD_CAST "Name", BAD_CAST name.c_str());
-    xmlNewProp(att_node, BAD_CAST "Value", BAD_CAST value.c_str());
+  int write(ArchiveWriter& writer) override{
+    writer.beginElement(Element::ATTRIBUTE_ELEMENT);
+    writer.writeAttribute("Name", name.c_str());
+    writer.writeAttribute("Value", value.c_str());
 
-    return att_node;
+    return writer.endElement();
   };
   
-  int deserialize(xmlNodePtr node, Parsable *_parent) override{
-    if(!xidx::isNodeName(node,"Attribute"))
+  int read(ArchiveReader& reader, Parsable *_parent) override{
+    if(reader.getElement() != Element::ATTRIBUTE_ELEMENT)
       return -1;
     
     setParent(_parent);
 
-    name = xidx::getProp(node, "Name");
-    value = xidx::getProp(node, "Value");
+    name = reader.readAttribute("Name");
+    value = reader.readAttribute("Value");
 
     return 0;
   };
@@ -33,15 +33,181 @@
 #include <algorithm>
 #include <sstream>
 #include <cctype>
+#include <cstdlib>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
 #include "xidx/xidx.h"
 
 namespace xidx{
 
 class Variable;
+
+// Numbers are read as a stream would read them, strtod would also accept
+// inf, nan and hexadecimal values
+inline bool isPlainNumber(const char* cur, const char* end){
+  for(; cur < end; cur++)
+    if(!std::isspace((unsigned char)*cur) && !std::isdigit((unsigned char)*cur) && strchr("+-.eE", *cur) == NULL)
+      return false;
+  return true;
+}
+
+// Parse the whitespace separated numbers of an inline XML array, up to the
+// first token that is not a number
+inline size_t decodeTextValues(const char* text, std::vector<double>& values){
+  size_t count = 0;
+  const char* cur = text;
+  char* next = nullptr;
+
+  while(*cur){
+    double v = strtod(cur, &next);
+    if(next == cur || !isPlainNumber(cur, next))
+      break;
+    values.push_back(v);
+    cur = next;
+    count++;
+  }
+
+  return count;
+}
+
+inline size_t countTextValues(const char* cur, const char* end){
+  size_t count = 0;
+  bool in_token = false;
+  for(; cur < end; cur++){
+    bool space = std::isspace((unsigned char)*cur) != 0;
+    if(!space && !in_token)
+      count++;
+    in_token = !space;
+  }
+  return count;
+}
+
+// Parse exactly count whitespace separated numbers of [cur, end) into out,
+// false if the range does not hold exactly such numbers
+inline bool parseTextValues(const char* cur, const char* end, double* out, size_t count){
+  char* next = nullptr;
+  for(size_t i=0; i < count; i++){
+    while(cur < end && std::isspace((unsigned char)*cur))
+      cur++;
+    if(cur >= end)
+      return false;
+    
+    out[i] = strtod(cur, &next);
+    if(next == cur || next > end || (next < end && !std::isspace((unsigned char)*next)) ||
+       !isPlainNumber(cur, next))
+      return false;
+    cur = next;
+  }
+  
+  while(cur < end && std::isspace((unsigned char)*cur))
+    cur++;
+  return cur == end;
+}
+
+// Parse a large inline array on the threads of the pool: the text is split
+// at whitespace, the values of each block are counted and then parsed into
+// their slice of the output. The result is the one of decodeTextValues.
+inline size_t decodeTextValuesParallel(const char* text, size_t length, std::vector<double>& values){
+  ThreadPool& pool = ThreadPool::global();
+  if(length < XIDX_PARALLEL_DECODE_THRESHOLD || pool.getNumberOfWorkers() == 0)
+    return decodeTextValues(text, values);
+  
+  const char* text_end = text + length;
+  std::vector<const char*> bounds(1, text);
+  for(size_t pos = XIDX_PARALLEL_DECODE_BLOCK; pos < length; pos += XIDX_PARALLEL_DECODE_BLOCK){
+    const char* b = text + pos;
+    while(b < text_end && !std::isspace((unsigned char)*b))
+      b++;
+    if(b > bounds.back() && b < text_end)
+      bounds.push_back(b);
+  }
+  bounds.push_back(text_end);
+  
+  size_t n_blocks = bounds.size()-1;
+  std::vector<size_t> offsets(n_blocks+1, 0);
+  pool.parallelFor(n_blocks, [&](size_t b){ offsets[b+1] = countTextValues(bounds[b], bounds[b+1]); });
+  for(size_t b=0; b < n_blocks; b++)
+    offsets[b+1] += offsets[b];
+  
+  size_t first = values.size();
+  values.resize(first + offsets[n_blocks]);
+  
+  std::vector<char> parsed(n_blocks, 0);
+  pool.parallelFor(n_blocks, [&](size_t b){
+    parsed[b] = parseTextValues(bounds[b], bounds[b+1], values.data()+first+offsets[b], offsets[b+1]-offsets[b]);
+  });
+  
+  // anything but plain numbers is left to the serial parse
+  for(auto p: parsed)
+    if(!p){
+      values.resize(first);
+      return decodeTextValues(text, values);
+    }
+  
+  return offsets[n_blocks];
+}
+
+// Incrementally parse an inline XML array delivered in chunks,
+// a number split between two chunks is kept until the next one.
+// Blocks of XIDX_PARALLEL_DECODE_BLOCK characters are parsed on the
+// thread pool and appended in order.
+class TextValuesDecoder{
+public:
+  void feed(const char* chunk, size_t length, std::vector<double>& values){
+    carry.append(chunk, length);
+    if(carry.size() < XIDX_PARALLEL_DECODE_BLOCK)
+      return;
+    
+    size_t end = carry.find_last_of(" \t\r\n");
+    if(end == std::string::npos)
+      return;
+    
+    std::shared_ptr<Block> block = std::make_shared<Block>();
+    block->text.assign(carry, 0, end);
+    carry.erase(0, end+1);
+    
+    ThreadPool& pool = ThreadPool::global();
+    block->done = pool.submit([block](){
+      decodeTextValues(block->text.c_str(), block->values);
+      std::string().swap(block->text);
+    });
+    in_flight.push_back(block);
+    
+    // bound the text and values waiting to be appended
+    while(in_flight.size() > 2*size_t(pool.getNumberOfWorkers()))
+      collect(values);
+  }
+  
+  void finish(std::vector<double>& values){
+    while(!in_flight.empty())
+      collect(values);
+    
+    decodeTextValues(carry.c_str(), values);
+    std::string().swap(carry);
+  }
+  
+private:
+  struct Block{
+    std::string text;
+    std::vector<double> values;
+    std::future<void> done;
+  };
+  
+  std::string carry;
+  std::deque<std::shared_ptr<Block> > in_flight;
+  
+  void collect(std::vector<double>& values){
+    std::shared_ptr<Block> block = in_flight.front();
+    in_flight.pop_front();
+    block->done.wait();
+    values.insert(values.end(), block->values.begin(), block->values.end());
+  }
+};
   
 class Endianess{
 public:
-  enum EndianType{
+  enum EndianType : uint8_t{
     LITTLE_ENDIANESS = 0,
     BIG_ENDIANESS = 1,
     NATIVE_ENDIANESS = 2
@@ -57,13 +223,18 @@ public:
       default:                  return "[Unknown]";
     }
   }
+  
+  static inline bool fromString(const char* s, EndianType& v){
+    static const NameTable<EndianType> table(LITTLE_ENDIANESS, NATIVE_ENDIANESS, toString);
+    return table.find(s, v);
+  }
 };
   
 class DataItem : public xidx::Parsable{
   friend class DataSource;
 public:
   
-  enum FormatType{
+  enum FormatType : uint8_t{
     XML_FORMAT = 0,
     HDF_FORMAT = 1,
     BINARY_FORMAT = 2,
@@ -84,34 +255,44 @@ public:
     }
   }
   
+  static inline bool fromString(const char* s, FormatType& v){
+    static const NameTable<FormatType> table(XML_FORMAT, IDX_FORMAT, toString);
+    return table.find(s, v);
+  }
+  
   class defaults{
   public:
+    static const int DATAITEM_BIT_PRECISION_VALUE = 32;
+    static const int DATAITEM_N_COMPONENTS_VALUE = 1;
+    // string forms, from when the fields of the item were strings
     static const char* DATAITEM_BIT_PRECISION(){ return "32"; }
     static const char* DATAITEM_N_COMPONENTS() { return "1";  }
     static const DataItem::FormatType DATAITEM_FORMAT_TYPE = DataItem::FormatType::XML_FORMAT;
     static const XidxDataType::NumberType DATAITEM_NUMBER_TYPE = XidxDataType::NumberType::FLOAT_NUMBER_TYPE;
     static const Endianess::EndianType DATAITEM_ENDIAN_TYPE = Endianess::EndianType::LITTLE_ENDIANESS;
+    static const Encoding::EncodingType DATAITEM_ENCODING_TYPE = Encoding::EncodingType::TEXT_ENCODING;
+    static const Encoding::CompressionType DATAITEM_COMPRESSION_TYPE = Encoding::CompressionType::NO_COMPRESSION;
   };
   
 public:
-  std::vector<INDEX_TYPE> dimensions;
+  IndexVector dimensions;
+  std::shared_ptr<DataSource> data_source;
+  int bit_precision;
+  int n_components;
   XidxDataType::NumberType number_type;
-  //TODO change these strings into number types
-  std::string bit_precision;
-  std::string n_components;
-  std::string reference;
-  std::string text;
   Endianess::EndianType endian_type;
   DataItem::FormatType format_type;
-  std::shared_ptr<DataSource> data_source;
-  std::vector<Attribute> attributes;
+  Encoding::EncodingType encoding_type;
+  Encoding::CompressionType compression_type;
   
   int setDefaults(){
     format_type=defaults::DATAITEM_FORMAT_TYPE;
     number_type=defaults::DATAITEM_NUMBER_TYPE;
-    bit_precision=defaults::DATAITEM_BIT_PRECISION();
-    n_components=defaults::DATAITEM_N_COMPONENTS();
+    bit_precision=defaults::DATAITEM_BIT_PRECISION_VALUE;
+    n_components=defaults::DATAITEM_N_COMPONENTS_VALUE;
     endian_type=defaults::DATAITEM_ENDIAN_TYPE;
+    encoding_type=defaults::DATAITEM_ENCODING_TYPE;
+    compression_type=defaults::DATAITEM_COMPRESSION_TYPE;
     data_source=nullptr;
     return 0;
   }
@@ -122,19 +303,31 @@ public:
   }
   
   DataItem(const DataItem& i){
+    *this = i;
+  }
+
+  DataItem& operator=(const DataItem& i){
+    if(this == &i)
+      return *this;
+
+    std::lock_guard<std::mutex> lock(valuesMutex(&i));
     setParent(i.getParent());
     name=i.name;
     dimensions=i.dimensions;
     number_type=i.number_type;
     bit_precision=i.bit_precision;
     n_components=i.n_components;
-    reference=i.reference;
-    text=i.text;
     endian_type=i.endian_type;
     format_type=i.format_type;
     data_source=i.data_source;
-    attributes=i.attributes;
+    extras.reset(i.extras != nullptr ? new Extras(*i.extras) : nullptr);
+    encoding_type=i.encoding_type;
+    compression_type=i.compression_type;
     values=i.values;
+    values_decoded.store(i.values_decoded.load());
+    text_encoding_type=i.text_encoding_type;
+    text_compression_type=i.text_compression_type;
+    return *this;
   }
   
   DataItem(std::string dtype, Parsable* _parent){
@@ -151,8 +344,8 @@ public:
     format_type=format;
     
     number_type=dtype.type;
-    bit_precision=std::to_string(dtype.bit_precision);
-    n_components=std::to_string(dtype.n_components);
+    bit_precision=dtype.bit_precision;
+    n_components=dtype.n_components;
     
     data_source=nullptr;
     
@@ -167,37 +360,54 @@ public:
     data_source=ds;
   }
   
-  virtual xmlNodePtr serialize(xmlNode *parent_node, const char *text = NULL) override{
-    
-    if(values.size()>0 && format_type == FormatType::XML_FORMAT){
-      std::stringstream stream_data;
-      for(auto& v:values)
-        stream_data<<v<<" ";
-      this->text=std::string(stream_data.str());
+  virtual int write(ArchiveWriter& writer) override{
+    
+    // values that were never decoded are written back as they were read
+    std::string content;
+    bool verbatim = !values_decoded && encoding_type == text_encoding_type && compression_type == text_compression_type;
+    if(format_type == FormatType::XML_FORMAT && !verbatim)
+      decodeValues();
+    
+    if(values_decoded && values.size()>0 && format_type == FormatType::XML_FORMAT){
+      if(Encoding::isBinary(encoding_type))
+        content=encodeValues();
+      else{
+        std::stringstream stream_data;
+        for(auto& v:values)
+          stream_data<<v<<" ";
+        content=stream_data.str();
+      }
     }
+    else
+      content=getText();
     
-    xmlNodePtr data_node = xmlNewChild(parent_node, NULL, BAD_CAST "DataItem", BAD_CAST this->text.c_str());
+    writer.beginElement(Element::DATA_ITEM_ELEMENT, content.c_str());
     
     if(name.size())
-      xmlNewProp(data_node, BAD_CAST "Name", BAD_CAST name.c_str());
+      writer.writeAttribute("Name", name.c_str());
     
     if(format_type != defaults::DATAITEM_FORMAT_TYPE)
-      xmlNewProp(data_node, BAD_CAST "Format", BAD_CAST toString(format_type));
+      writer.writeAttribute("Format", toString(format_type));
     
-      xmlNewProp(data_node, BAD_CAST "NumberType", BAD_CAST XidxDataType::toString(number_type));
-    if(strcmp(bit_precision.c_str(), defaults::DATAITEM_BIT_PRECISION()) != 0 || format_type == FormatType::IDX_FORMAT)
-      xmlNewProp(data_node, BAD_CAST "BitPrecision", BAD_CAST bit_precision.c_str());
+      writer.writeAttribute("NumberType", XidxDataType::toString(number_type));
+    if(bit_precision != defaults::DATAITEM_BIT_PRECISION_VALUE || format_type == FormatType::IDX_FORMAT)
+      writer.writeAttribute("BitPrecision", std::to_string(bit_precision).c_str());
     if(endian_type != defaults::DATAITEM_ENDIAN_TYPE)
-      xmlNewProp(data_node, BAD_CAST "Endian", BAD_CAST Endianess::toString(endian_type));
+      writer.writeAttribute("Endian", Endianess::toString(endian_type));
 
     if(dimensions.size())
-      xmlNewProp(data_node, BAD_CAST "Dimensions", BAD_CAST xidx::toString(dimensions).c_str());
+      writer.writeAttribute("Dimensions", xidx::toString(dimensions).c_str());
 
-    if(n_components != defaults::DATAITEM_N_COMPONENTS())
-      xmlNewProp(data_node, BAD_CAST "ComponentNumber", BAD_CAST n_components.c_str());
+    if(n_components != defaults::DATAITEM_N_COMPONENTS_VALUE)
+      writer.writeAttribute("ComponentNumber", std::to_string(n_components).c_str());
+    
+    if(encoding_type != defaults::DATAITEM_ENCODING_TYPE)
+      writer.writeAttribute("Encoding", Encoding::toString(encoding_type));
+    if(compression_type != defaults::DATAITEM_COMPRESSION_TYPE)
+      writer.writeAttribute("Compression", Encoding::toString(compression_type));
 
     if(data_source != nullptr)
-      xmlNodePtr ds_node = data_source->serialize(data_node);
+      data_source->write(writer);
     
 #if XIDX_DEBUG_XPATHS
     else if(format_type != FormatType::XML_FORMAT){
@@ -221,23 +431,33 @@ public:
     }
 #endif
     
-    for(auto att: attributes){
-      xmlNodePtr att_node = att.serialize(data_node);
+    for(auto att: getAttributes()){
+      att.write(writer);
     }
 
-    return data_node;
+    return writer.endElement();
   };
   
-  virtual int deserialize(xmlNodePtr node, Parsable *_parent) override{
-    if(!xidx::isNodeName(node,"DataItem"))
+  virtual int read(ArchiveReader& reader, Parsable *_parent) override{
+    if(reader.getElement() != Element::DATA_ITEM_ELEMENT)
       return -1;
 
     setParent(_parent);
     
-    if(node->children != nullptr)
-      text = (char*)(node->children->content);
+    // inline values are decoded on first access
+    values.clear();
+    values_decoded = false;
+    const char* content = reader.readText();
+    if(content != nullptr)
+      getExtras().text = content;
+    else if(extras != nullptr)
+      extras->text.clear();
     
-    const char* name_s = xidx::getProp(node, "Name");
+    // large arrays may have been decoded while the document was read
+    if(reader.takeValues(values))
+      values_decoded = true;
+    
+    const char* name_s = reader.readAttribute("Name");
     
     if(name_s != nullptr)
       name = name_s;
@@ -245,106 +465,215 @@ public:
     if(this->getParent()==nullptr)
       printf("%s has no parent\n", name.c_str());
     
-    const char* form_type = xidx::getProp(node, "Format");
+    const char* form_type = reader.readAttribute("Format");
     if(form_type != NULL){
-      for(int t=FormatType::XML_FORMAT; t <= IDX_FORMAT; t++)
-        if (strcmp(form_type, toString(static_cast<FormatType>(t)))==0){
-          format_type = static_cast<FormatType>(t);
-          break;
-        }
+      fromString(form_type, format_type);
     }
 
-    const char* num_type = xidx::getProp(node, "NumberType");
+    const char* num_type = reader.readAttribute("NumberType");
     if(num_type != NULL){
-      for(int t=XidxDataType::NumberType::CHAR_NUMBER_TYPE; t <= XidxDataType::NumberType::UINT_NUMBER_TYPE; t++)
-        if (strcmp(num_type, XidxDataType::toString(static_cast<XidxDataType::NumberType>(t)))==0){
-          number_type = static_cast<XidxDataType::NumberType>(t);
-          break;
-        }
+      XidxDataType::fromString(num_type, number_type);
     }
     else{
       number_type = defaults::DATAITEM_NUMBER_TYPE;
     }
     
-    const char* val_precision = xidx::getProp(node, "BitPrecision");
+    const char* val_precision = reader.readAttribute("BitPrecision");
     if(val_precision == NULL)
-      bit_precision = defaults::DATAITEM_BIT_PRECISION();
+      bit_precision = defaults::DATAITEM_BIT_PRECISION_VALUE;
     else 
-      bit_precision = val_precision;
+      bit_precision = atoi(val_precision);
 
-    const char* val_components = xidx::getProp(node, "ComponentNumber");
+    const char* val_components = reader.readAttribute("ComponentNumber");
     if(val_components == NULL)
-      n_components = defaults::DATAITEM_N_COMPONENTS();
+      n_components = defaults::DATAITEM_N_COMPONENTS_VALUE;
     else 
-      n_components = val_components;
+      n_components = atoi(val_components);
 
     //if(format_type != FormatType::IDX_FORMAT) { // Ignore dimensions for IDX
-      const char* val_dimensions = xidx::getProp(node, "Dimensions");
+      const char* val_dimensions = reader.readAttribute("Dimensions");
       if(val_dimensions != NULL)
         dimensions = toIndexVector(val_dimensions);
     //}
 
-    const char* end_type = xidx::getProp(node, "Endian");
+    const char* end_type = reader.readAttribute("Endian");
     if (end_type != NULL){
-      for(int t=Endianess::EndianType::LITTLE_ENDIANESS; t <= Endianess::NATIVE_ENDIANESS; t++)
-        if (strcmp(end_type, Endianess::toString(static_cast<Endianess::EndianType>(t)))==0){
-          endian_type = static_cast<Endianess::EndianType>(t);
-          break;
-        }
+      Endianess::fromString(end_type, endian_type);
     }
     else
       endian_type = defaults::DATAITEM_ENDIAN_TYPE;
-
-    if(format_type == FormatType::XML_FORMAT){
-      
-      std::stringstream stream_data(text);
-
-      values.clear();
-      double n ;
-      while( stream_data >> n ) values.push_back(n);
-
-//      Parsable* parent_group = findParent("Group", parent);
-//
-////      if(node != nullptr)
-////        file_ref->deserialize(node->children);
+    
+    encoding_type = defaults::DATAITEM_ENCODING_TYPE;
+    const char* enc_type = reader.readAttribute("Encoding");
+    if (enc_type != NULL){
+      Encoding::fromString(enc_type, encoding_type);
     }
     
-    if(node->children != nullptr){
-      for (xmlNode* cur_node = node->children->next; cur_node; cur_node = cur_node->next) {
-          if (cur_node->type == XML_ELEMENT_NODE) {
-            if(isNodeName(cur_node, "DataSource")){
-              data_source = std::make_shared<DataSource>(new DataSource());
-              data_source->deserialize(cur_node, this);
-              
-            }
+    compression_type = defaults::DATAITEM_COMPRESSION_TYPE;
+    const char* comp_type = reader.readAttribute("Compression");
+    if (comp_type != NULL){
+      Encoding::fromString(comp_type, compression_type);
+    }
+    
+    text_encoding_type = encoding_type;
+    text_compression_type = compression_type;
+
+    if(reader.firstChild()){
+      do{
+        if(reader.getElement() == Element::DATA_SOURCE_ELEMENT){
+          data_source = std::make_shared<DataSource>(new DataSource());
+          data_source->read(reader, this);
         }
-      }
+      } while(reader.nextSibling());
+      reader.parent();
     }
     
     return 0;
   };
   
-  const std::vector<double>& getValues() const{ return values; }
+  const std::vector<double>& getValues() const{
+    decodeValues();
+    return values;
+  }
+  
+  bool isDecoded() const { return values_decoded; }
+  
+  // Whether both items hold the same values, text that was not decoded yet
+  // is compared without being decoded in place
+  bool sameValues(const DataItem& other) const{
+    if(this == &other)
+      return true;
+    
+    std::vector<double> scratch, other_scratch;
+    return peekValues(scratch) == other.peekValues(other_scratch);
+  }
+  
+  // Estimate of the memory held by the item, text and decoded values included
+  size_t getMemoryUsage() const{
+    std::lock_guard<std::mutex> lock(valuesMutex(this));
+    size_t usage = sizeof(DataItem) + values.capacity()*sizeof(double);
+    if(dimensions.isWide())
+      usage += dimensions.capacity()*sizeof(INDEX_TYPE);
+    if(extras != nullptr)
+      usage += sizeof(Extras) + extras->text.capacity() + extras->reference.capacity() +
+               extras->attributes.capacity()*sizeof(Attribute);
+    return usage;
+  }
+  
+  // Inline content as read or set, empty once decoded into values
+  const std::string& getText() const{
+    static const std::string none;
+    return extras != nullptr ? extras->text : none;
+  }
+  
+  // Replace the content with values written as text, e.g. "0 1 2", which
+  // are decoded on first access
+  void setText(std::string _text){
+    std::lock_guard<std::mutex> lock(valuesMutex(this));
+    values.clear();
+    values_decoded = false;
+    if(extras != nullptr || !_text.empty())
+      getExtras().text.swap(_text);
+    text_encoding_type = Encoding::EncodingType::TEXT_ENCODING;
+    text_compression_type = Encoding::CompressionType::NO_COMPRESSION;
+  }
+  
+  const std::vector<Attribute>& getAttributes() const{
+    static const std::vector<Attribute> none;
+    return extras != nullptr ? extras->attributes : none;
+  }
+  
+  int addAttribute(const Attribute& att){
+    getExtras().attributes.push_back(att);
+    return 0;
+  }
+  
+  // String accessors of bit_precision and n_components, which used to be
+  // strings as written in the file
+  std::string getBitPrecision() const { return std::to_string(bit_precision); }
+  int setBitPrecision(const std::string& precision){ bit_precision = atoi(precision.c_str()); return 0; }
+  
+  std::string getComponentNumber() const { return std::to_string(n_components); }
+  int setComponentNumber(const std::string& components){ n_components = atoi(components.c_str()); return 0; }
+  
+  std::string getReference() const{ return extras != nullptr ? extras->reference : ""; }
+  
+  int setReference(const std::string& reference){
+    getExtras().reference = reference;
+    return 0;
+  }
+  
+  // Replace the content with already decoded values, dimensions are left unchanged
+  void setValues(std::vector<double> _values){
+    std::lock_guard<std::mutex> lock(valuesMutex(this));
+    values.swap(_values);
+    values_decoded = true;
+    if(extras != nullptr)
+      std::string().swap(extras->text);
+  }
+  
+  // Replace the content with text already in the given encoding
+  void setEncodedText(std::string _text, Encoding::EncodingType encoding,
+                      Encoding::CompressionType compression=Encoding::CompressionType::NO_COMPRESSION){
+    std::lock_guard<std::mutex> lock(valuesMutex(this));
+    values.clear();
+    values_decoded = false;
+    getExtras().text.swap(_text);
+    encoding_type = text_encoding_type = encoding;
+    compression_type = text_compression_type = compression;
+  }
+  
+  // Drop the decoded values, text becomes the only content of the item
+  void clearValues(){
+    std::lock_guard<std::mutex> lock(valuesMutex(this));
+    values.clear();
+    values_decoded = false;
+    text_encoding_type = Encoding::EncodingType::TEXT_ENCODING;
+    text_compression_type = Encoding::CompressionType::NO_COMPRESSION;
+  }
+  
+  // Select how the inline values are written, e.g. base64 of the raw
+  // little endian values optionally compressed with zlib, or for integer
+  // types delta varints or bit packed offsets
+  int setEncoding(Encoding::EncodingType encoding, Encoding::CompressionType compression=Encoding::CompressionType::NO_COMPRESSION){
+    if(compression != Encoding::CompressionType::NO_COMPRESSION && !Encoding::isBinary(encoding)){
+      fprintf(stderr, "Compression requires a binary encoding\n");
+      return 1;
+    }
+    
+    if(Encoding::isIntegerOnly(encoding) && number_type == XidxDataType::NumberType::FLOAT_NUMBER_TYPE){
+      fprintf(stderr, "Encoding %s requires an integer number type\n", Encoding::toString(encoding));
+      return 1;
+    }
+    
+    if(!Encoding::isCompressionSupported(compression)){
+      fprintf(stderr, "Compression %s is not supported by this build\n", Encoding::toString(compression));
+      return 1;
+    }
+    
+    encoding_type = encoding;
+    compression_type = compression;
+    return 0;
+  }
   
   virtual size_t getVolume() const{
-    size_t total = 1;
-    for(int i=0; i < dimensions.size(); i++)
-      total *= dimensions[i];
-    return total;
+    return volumeOf(dimensions);
   }
   
   int addValue(double v, int stride){
+    decodeValues();
     values.push_back(v);
     dimensions.resize(stride);
-    dimensions[0] = values.size()/stride;
-    dimensions[1] = stride;
+    dimensions.set(0, values.size()/stride);
+    dimensions.set(1, stride);
     return 0;
   }
   
   int addValue(double v){
+    decodeValues();
     values.push_back(v);
     dimensions.resize(1);
-    dimensions[0] = values.size();
+    dimensions.set(0, values.size());
     return 0;
   }
   
@@ -400,7 +729,134 @@ public:
   
 private:
   
-  std::vector<double> values;
+  mutable std::vector<double> values;
+  mutable std::atomic<bool> values_decoded{false};
+  // encoding of the inline text
+  Encoding::EncodingType text_encoding_type = Encoding::EncodingType::TEXT_ENCODING;
+  Encoding::CompressionType text_compression_type = Encoding::CompressionType::NO_COMPRESSION;
+  
+  // Fields that items without inline content do not have, allocated on
+  // first use
+  struct Extras{
+    std::string text;
+    std::string reference;
+    std::vector<Attribute> attributes;
+  };
+  std::unique_ptr<Extras> extras;
+  
+  Extras& getExtras(){
+    if(extras == nullptr)
+      extras.reset(new Extras());
+    return *extras;
+  }
+  
+  // The items share a table of locks guarding their values and text rather
+  // than holding one each, no lock is taken while another one is held
+  static std::mutex& valuesMutex(const DataItem* item){
+    static std::mutex locks[64];
+    return locks[(reinterpret_cast<uintptr_t>(item) >> 4) % 64];
+  }
+  
+  bool isLittleEndian() const{
+    if(endian_type == Endianess::EndianType::NATIVE_ENDIANESS)
+      return Encoding::isHostLittleEndian();
+    return endian_type == Endianess::EndianType::LITTLE_ENDIANESS;
+  }
+  
+  std::string encodeValues() const{
+    std::vector<unsigned char> bytes;
+    if(Encoding::encode(encoding_type, values, number_type, bit_precision, isLittleEndian(), bytes) != 0)
+      return "";
+    if(Encoding::compress(compression_type, bytes) != 0)
+      return "";
+    
+    return Encoding::base64Encode(bytes.data(), bytes.size());
+  }
+  
+  // Number of values of the Dimensions times the components of each,
+  // 0 if unknown, i.e., without Dimensions or when it does not fit in a size_t
+  size_t expectedCount() const{
+    if(dimensions.size() == 0)
+      return 0;
+    
+    size_t count = volumeOf(dimensions);
+    if(n_components > 1 && !multiplyVolume(count, uint64_t(n_components)))
+      return 0;
+    return count;
+  }
+  
+  // Decode source, inline text in the given encoding, into out
+  int decodeText(const std::string& source, Encoding::EncodingType encoding,
+                 Encoding::CompressionType compression, std::vector<double>& out) const{
+    if(!Encoding::isBinary(encoding)){
+      decodeTextValuesParallel(source.c_str(), source.size(), out);
+      return 0;
+    }
+    
+    std::vector<unsigned char> bytes;
+    if(Encoding::base64Decode(source.c_str(), bytes) != 0)
+      return 1;
+    
+    // without Dimensions the size is only known once inflated
+    size_t count = expectedCount();
+    size_t n_bytes = Encoding::encodedSize(encoding, count, number_type, bit_precision);
+    if(Encoding::uncompress(compression, bytes, n_bytes) != 0)
+      return 1;
+    
+    return Encoding::decode(encoding, bytes.data(), bytes.size(), number_type, bit_precision, isLittleEndian(), out, count);
+  }
+  
+  // The values of the item without decoding them in place, scratch holds
+  // them when the text was not decoded yet
+  const std::vector<double>& peekValues(std::vector<double>& scratch) const{
+    if(values_decoded.load(std::memory_order_acquire))
+      return values;
+    
+    std::string source;
+    Encoding::EncodingType encoding = Encoding::EncodingType::TEXT_ENCODING;
+    Encoding::CompressionType compression = Encoding::CompressionType::NO_COMPRESSION;
+    {
+      std::lock_guard<std::mutex> lock(valuesMutex(this));
+      if(values_decoded.load(std::memory_order_relaxed))
+        return values;
+      if(format_type != FormatType::XML_FORMAT || getText().empty())
+        return scratch;
+      source = getText();
+      encoding = text_encoding_type;
+      compression = text_compression_type;
+    }
+    
+    if(decodeText(source, encoding, compression, scratch) != 0)
+      fprintf(stderr, "Failed to decode DataItem %s\n", name.c_str());
+    return scratch;
+  }
+  
+  // Convert the inline text into values and release the text,
+  // safe to be called concurrently on the same item. The lock is not held
+  // while decoding, which can run tasks of the thread pool that decode this
+  // same item; when threads race the values published first are kept.
+  void decodeValues() const{
+    if(values_decoded.load(std::memory_order_acquire))
+      return;
+    
+    std::vector<double> decoded;
+    if(&peekValues(decoded) == &values)
+      return;
+    
+    std::lock_guard<std::mutex> lock(valuesMutex(this));
+    if(values_decoded.load(std::memory_order_relaxed))
+      return;
+    
+    if(format_type == FormatType::XML_FORMAT && getText().size()){
+      DataItem* self = const_cast<DataItem*>(this);
+      values.swap(decoded);
+      std::string().swap(self->extras->text);
+      self->text_encoding_type = Encoding::EncodingType::TEXT_ENCODING;
+      self->text_compression_type = Encoding::CompressionType::NO_COMPRESSION;
+    }
+    
+    values_decoded.store(true, std::memory_order_release);
+  }
   
   int ParseDType(std::string dtype){
     if(!std::isdigit(dtype[0])){ // passed name, not dtype
@@ -411,7 +867,7 @@ private:
     
     size_t comp_idx= dtype.find_last_of("*\\");
     // TODO this uses only 1 digit component
-    n_components = dtype.substr(0,comp_idx);
+    n_components = atoi(dtype.substr(0,comp_idx).c_str());
     
     size_t num_idx=0;
     for(int i=comp_idx;i<dtype.size(); i++)
@@ -421,7 +877,7 @@ private:
         break;
     
     std::string ntype = dtype.substr(comp_idx+1, num_idx-1);
-    bit_precision = dtype.substr(num_idx+1);
+    bit_precision = atoi(dtype.substr(num_idx+1).c_str());
     
     for(int t=XidxDataType::NumberType::CHAR_NUMBER_TYPE; t <= XidxDataType::NumberType::UINT_NUMBER_TYPE; t++){
       std::string numType = XidxDataType::toString(static_cast<XidxDataType::NumberType>(t));
@@ -56,6 +56,11 @@ public:
       default:                             return "[Unknown]";
     }
   }
+  
+  static inline bool fromString(const char* s, DomainType& v){
+    static const NameTable<DomainType> table(HYPER_SLAB_DOMAIN_TYPE, RANGE_DOMAIN_TYPE, toString);
+    return table.find(s, v);
+  }
 
 protected:
   std::vector<std::shared_ptr<Attribute>> attributes;
@@ -83,77 +88,83 @@ public:
 
   int addDataItem(std::shared_ptr<DataItem> item){
     data_items.push_back(item);
+    markModified();
     return 0;
   }
   
   virtual int addDataItem(std::string name, Parsable *parent){
     data_items.push_back(std::make_shared<DataItem>(new DataItem(name, parent)));
+    markModified();
     return 0;
   }
   
   virtual int addAttribute(std::string name, std::string value){
     attributes.push_back(std::make_shared<Attribute>(new Attribute(name, value)));
+    attributes.back()->setParent(this);
+    markModified();
     return 0;
   }
   
+  // Give a copy of a domain its own data items and attributes, so that it
+  // does not change with the domain it was copied from
+  virtual void detach(){
+    for(auto& item: data_items){
+      item = std::make_shared<DataItem>(*item);
+      item->setParent(this);
+      if(item->data_source != nullptr)
+        item->data_source = std::make_shared<DataSource>(item->data_source.get());
+    }
+    
+    for(auto& att: attributes){
+      att = std::make_shared<Attribute>(att.get());
+      att->setParent(this);
+    }
+  }
+  
   std::vector<std::shared_ptr<Attribute>> getAttributes() const{ return attributes; }
   
-  virtual xmlNodePtr serialize(xmlNode *parent, const char *text = NULL) override{
-    //Parsable::serialize(parent);
+  virtual int write(ArchiveWriter& writer) override{
+    //Parsable::write(writer);
 
-    xmlNodePtr domain_node = xmlNewChild(parent, NULL, BAD_CAST "Domain", NULL);
-    xmlNewProp(domain_node, BAD_CAST "Type", BAD_CAST toString(type));
-
-    for(auto item: data_items)
-      xmlNodePtr item_node = item->serialize(domain_node);
-      
-    for(auto att: attributes)
-      xmlNodePtr item_att = att->serialize(domain_node);
-
-    return domain_node;
+    beginDomain(writer);
+    return writer.endElement();
   };
   
-  virtual int deserialize(xmlNodePtr node, Parsable *_parent) override{
-    //Parsable::deserialize(node); // TODO use the parent class to serialize name??
+  virtual int read(ArchiveReader& reader, Parsable *_parent) override{
+    //Parsable::read(reader); // TODO use the parent class to serialize name??
     setParent(_parent);
     
     assert(this->getParent()!=nullptr);
     
-    const char* domain_type = xidx::getProp(node, "Type");
+    const char* domain_type = reader.readAttribute("Type");
 
-    for(int t=DomainType::HYPER_SLAB_DOMAIN_TYPE; t <= DomainType::RANGE_DOMAIN_TYPE; t++)
-      if (strcmp(domain_type, toString(static_cast<DomainType>(t)))==0)
-          type = static_cast<DomainType>(t);
-    
-    for(int t=DomainType::HYPER_SLAB_DOMAIN_TYPE; t <= DomainType::RANGE_DOMAIN_TYPE; t++)
-      if (strcmp(domain_type, toString(static_cast<DomainType>(t)))==0)
-        type = static_cast<DomainType>(t);
+    fromString(domain_type, type);
     
     int data_items_count=0;
-    for (xmlNode* cur_node = node->children->next; cur_node; cur_node = cur_node->next) {
-      
-      if (cur_node->type == XML_ELEMENT_NODE) {
+    if(reader.firstChild()){
+      do{
+        Element::ElementType element = reader.getElement();
         
-        if(isNodeName(cur_node, "DataItem")){
+        if(element == Element::DATA_ITEM_ELEMENT){
           if(data_items.size() > data_items_count){
             std::shared_ptr<DataItem> d = data_items[data_items_count];
-            d->deserialize(cur_node, this);
+            d->read(reader, this);
           }
           else{
             std::shared_ptr<DataItem> d(new DataItem(this));
-            d->deserialize(cur_node, this);
+            d->read(reader, this);
             data_items.push_back(d);
           }
           
           data_items_count++;
         }
-        else if(isNodeName(cur_node, "Attribute")){
+        else if(element == Element::ATTRIBUTE_ELEMENT){
           std::shared_ptr<Attribute> att(new Attribute());
-          att->deserialize(cur_node, this);
+          att->read(reader, this);
           attributes.push_back(att);
         }
-      }
-      
+      } while(reader.nextSibling());
+      reader.parent();
     }
 
     return 0;
@@ -162,14 +173,31 @@ public:
   virtual size_t getVolume() const{
     size_t total = 1;
     for(auto& item: this->data_items)
-      for(int i=0; i < item->dimensions.size(); i++)
-        total *= item->dimensions[i];
+      if(!multiplyVolume(total, item->getVolume()))
+        return 0;
     return total;
   }
   
   virtual const IndexSpace& getLinearizedIndexSpace() = 0;
   
   virtual std::string getClassName() const override { return "Domain"; };
+  
+protected:
+  
+  // Open the element of the domain with its data items and attributes, the
+  // subclasses add their own children before closing it
+  int beginDomain(ArchiveWriter& writer){
+    writer.beginElement(Element::DOMAIN_ELEMENT);
+    writer.writeAttribute("Type", toString(type));
+
+    for(auto item: data_items)
+      item->write(writer);
+      
+    for(auto att: attributes)
+      att->write(writer);
+    
+    return 0;
+  }
 
 };
 
@@ -0,0 +1,720 @@
+/*
+ * Copyright (c) 2017 University of Utah
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef XIDX_ENCODING_H_
+#define XIDX_ENCODING_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#if XIDX_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "xidx_types.h"
+
+namespace xidx{
+
+class Encoding{
+public:
+  enum EncodingType : uint8_t{
+    TEXT_ENCODING = 0,
+    BASE64_ENCODING = 1,
+    DELTA_VARINT_ENCODING = 2,
+    BIT_PACKED_ENCODING = 3
+  };
+  
+  static inline const char* toString(EncodingType v)
+  {
+    switch (v)
+    {
+      case TEXT_ENCODING:          return "Text";
+      case BASE64_ENCODING:        return "Base64";
+      case DELTA_VARINT_ENCODING:  return "DeltaVarint";
+      case BIT_PACKED_ENCODING:    return "BitPacked";
+      default:                     return "[Unknown]";
+    }
+  }
+  
+  static inline bool fromString(const char* s, EncodingType& v){
+    static const NameTable<EncodingType> table(TEXT_ENCODING, BIT_PACKED_ENCODING, toString);
+    return table.find(s, v);
+  }
+  
+  // Binary encodings are written as base64 text
+  static inline bool isBinary(EncodingType v){ return v != TEXT_ENCODING; }
+  
+  // Encodings that apply only to integer number types
+  static inline bool isIntegerOnly(EncodingType v){
+    return v == DELTA_VARINT_ENCODING || v == BIT_PACKED_ENCODING;
+  }
+  
+  enum CompressionType : uint8_t{
+    NO_COMPRESSION = 0,
+    ZLIB_COMPRESSION = 1
+  };
+  
+  static inline const char* toString(CompressionType v)
+  {
+    switch (v)
+    {
+      case NO_COMPRESSION:    return "None";
+      case ZLIB_COMPRESSION:  return "Zlib";
+      default:                return "[Unknown]";
+    }
+  }
+  
+  static inline bool fromString(const char* s, CompressionType& v){
+    static const NameTable<CompressionType> table(NO_COMPRESSION, ZLIB_COMPRESSION, toString);
+    return table.find(s, v);
+  }
+  
+  static inline bool isCompressionSupported(CompressionType v){
+#if XIDX_HAVE_ZLIB
+    return v == NO_COMPRESSION || v == ZLIB_COMPRESSION;
+#else
+    return v == NO_COMPRESSION;
+#endif
+  }
+  
+  static inline bool isHostLittleEndian(){
+    const uint16_t probe = 1;
+    return *reinterpret_cast<const unsigned char*>(&probe) == 1;
+  }
+  
+  // Size in bytes of a single value, 0 if the type cannot be stored raw
+  static inline size_t valueSize(XidxDataType::NumberType type, int bit_precision){
+    switch(type){
+      case XidxDataType::NumberType::CHAR_NUMBER_TYPE:
+      case XidxDataType::NumberType::UCHAR_NUMBER_TYPE:
+        return 1;
+      case XidxDataType::NumberType::FLOAT_NUMBER_TYPE:
+        return (bit_precision == 32 || bit_precision == 64) ? bit_precision/8 : 0;
+      case XidxDataType::NumberType::INT_NUMBER_TYPE:
+      case XidxDataType::NumberType::UINT_NUMBER_TYPE:
+        return (bit_precision == 8 || bit_precision == 16 ||
+                bit_precision == 32 || bit_precision == 64) ? bit_precision/8 : 0;
+      default:
+        return 0;
+    }
+  }
+  
+  // Convert values to raw bytes of the given type and byte order
+  static int pack(const std::vector<double>& values, XidxDataType::NumberType type,
+                  int bit_precision, bool little_endian, std::vector<unsigned char>& bytes){
+    size_t size = valueSize(type, bit_precision);
+    if(size == 0){
+      fprintf(stderr, "Cannot encode values of type %s with precision %d\n", XidxDataType::toString(type), bit_precision);
+      return 1;
+    }
+    
+    bytes.resize(values.size()*size);
+    unsigned char* out = bytes.data();
+    
+    if(type == XidxDataType::NumberType::FLOAT_NUMBER_TYPE && size == 8)
+      memcpy(out, values.data(), bytes.size());
+    else if(type == XidxDataType::NumberType::FLOAT_NUMBER_TYPE){
+      std::vector<float> floats(values.size());
+      for(size_t i=0; i < values.size(); i++){
+        if(!isInRange(values[i], type, size))
+          return outOfRange(values[i], type, bit_precision);
+        floats[i] = float(values[i]);
+      }
+      memcpy(out, floats.data(), bytes.size());
+    }
+    else{
+      for(size_t i=0; i < values.size(); i++, out += size){
+        if(!isInRange(values[i], type, size))
+          return outOfRange(values[i], type, bit_precision);
+        storeValue(values[i], type, size, out);
+      }
+    }
+    
+    if(little_endian != isHostLittleEndian())
+      swapBytes(bytes.data(), values.size(), size);
+    
+    return 0;
+  }
+  
+  // Convert raw bytes of the given type and byte order to values
+  static int unpack(const unsigned char* bytes, size_t n_bytes, XidxDataType::NumberType type,
+                    int bit_precision, bool little_endian, std::vector<double>& values){
+    size_t size = valueSize(type, bit_precision);
+    if(size == 0 || n_bytes % size != 0){
+      fprintf(stderr, "Invalid encoded data for type %s with precision %d\n", XidxDataType::toString(type), bit_precision);
+      return 1;
+    }
+    
+    size_t count = n_bytes/size;
+    size_t offset = values.size();
+    values.resize(offset + count);
+    
+    if(little_endian == isHostLittleEndian()){
+      if(type == XidxDataType::NumberType::FLOAT_NUMBER_TYPE && size == 8){
+        memcpy(values.data()+offset, bytes, n_bytes);
+        return 0;
+      }
+      
+      if(type == XidxDataType::NumberType::FLOAT_NUMBER_TYPE){
+        std::vector<float> floats(count);
+        memcpy(floats.data(), bytes, n_bytes);
+        for(size_t i=0; i < count; i++)
+          values[offset+i] = floats[i];
+        return 0;
+      }
+      
+      for(size_t i=0; i < count; i++, bytes += size)
+        values[offset+i] = loadValue(bytes, type, size);
+    }
+    else{
+      unsigned char swapped[8];
+      for(size_t i=0; i < count; i++, bytes += size){
+        for(size_t b=0; b < size; b++)
+          swapped[b] = bytes[size-1-b];
+        values[offset+i] = loadValue(swapped, type, size);
+      }
+    }
+    
+    return 0;
+  }
+  
+  // Values to the bytes of a binary encoding
+  static int encode(EncodingType encoding, const std::vector<double>& values, XidxDataType::NumberType type,
+                    int bit_precision, bool little_endian, std::vector<unsigned char>& bytes){
+    if(isIntegerOnly(encoding) && type == XidxDataType::NumberType::FLOAT_NUMBER_TYPE){
+      fprintf(stderr, "Encoding %s requires an integer number type\n", toString(encoding));
+      return 1;
+    }
+    
+    switch(encoding){
+      case DELTA_VARINT_ENCODING:  return deltaVarintEncode(values, type, bytes);
+      case BIT_PACKED_ENCODING:    return bitPackEncode(values, type, bytes);
+      default:                     return pack(values, type, bit_precision, little_endian, bytes);
+    }
+  }
+  
+  // Bytes of a binary encoding to values, expected_count bounds the number
+  // of values the bytes may declare, 0 if unknown
+  static int decode(EncodingType encoding, const unsigned char* bytes, size_t n_bytes, XidxDataType::NumberType type,
+                    int bit_precision, bool little_endian, std::vector<double>& values, size_t expected_count = 0){
+    switch(encoding){
+      case DELTA_VARINT_ENCODING:  return deltaVarintDecode(bytes, n_bytes, type, values);
+      case BIT_PACKED_ENCODING:    return bitPackDecode(bytes, n_bytes, type, values, expected_count);
+      default:                     return unpack(bytes, n_bytes, type, bit_precision, little_endian, values);
+    }
+  }
+  
+  // Size of the bytes of count values before compression, 0 if it depends on the values
+  static size_t encodedSize(EncodingType encoding, size_t count, XidxDataType::NumberType type, int bit_precision){
+    size_t size = count;
+    if(isIntegerOnly(encoding) || !multiplyVolume(size, valueSize(type, bit_precision)))
+      return 0;
+    return size;
+  }
+  
+  // Differences between consecutive values, zig-zag mapped and written as
+  // little endian base 128 varints
+  static int deltaVarintEncode(const std::vector<double>& values, XidxDataType::NumberType type,
+                               std::vector<unsigned char>& bytes){
+    bytes.clear();
+    bytes.reserve(values.size());
+    
+    uint64_t prev = 0;
+    for(auto v: values){
+      uint64_t cur = 0;
+      if(!toInteger(v, type, cur))
+        return outOfRange(v, type, 64);
+      uint64_t delta = cur - prev;
+      uint64_t zz = (delta << 1) ^ (uint64_t(0) - (delta >> 63));
+      
+      while(zz >= 0x80){
+        bytes.push_back(uint8_t(zz) | 0x80);
+        zz >>= 7;
+      }
+      bytes.push_back(uint8_t(zz));
+      prev = cur;
+    }
+    
+    return 0;
+  }
+  
+  static int deltaVarintDecode(const unsigned char* bytes, size_t n_bytes, XidxDataType::NumberType type,
+                               std::vector<double>& values){
+    bool is_signed = isSigned(type);
+    uint64_t prev = 0;
+    size_t pos = 0;
+    
+    values.reserve(values.size() + n_bytes);
+    
+    while(pos < n_bytes){
+      // eight single byte varints, i.e., no continuation bit in the whole word
+      if(pos + 8 <= n_bytes){
+        uint64_t word;
+        memcpy(&word, bytes+pos, 8);
+        if((word & 0x8080808080808080ULL) == 0){
+          for(int b=0; b < 8; b++){
+            uint64_t zz = bytes[pos+b];
+            prev += (zz >> 1) ^ (uint64_t(0) - (zz & 1));
+            values.push_back(toDouble(prev, is_signed));
+          }
+          pos += 8;
+          continue;
+        }
+      }
+      
+      uint64_t zz = 0;
+      int shift = 0;
+      unsigned char byte;
+      do{
+        if(pos >= n_bytes || shift > 63){
+          fprintf(stderr, "Truncated varint data\n");
+          return 1;
+        }
+        byte = bytes[pos++];
+        zz |= uint64_t(byte & 0x7F) << shift;
+        shift += 7;
+      } while(byte & 0x80);
+      
+      prev += (zz >> 1) ^ (uint64_t(0) - (zz & 1));
+      values.push_back(toDouble(prev, is_signed));
+    }
+    
+    return 0;
+  }
+  
+  // Frame of reference: the count (varint), the minimum (8 bytes) and the
+  // bit width (1 byte), followed by the offsets from the minimum packed
+  // with that width, least significant bit first. The width is at least 1,
+  // so that the count of values is bounded by the size of the data.
+  static int bitPackEncode(const std::vector<double>& values, XidxDataType::NumberType type,
+                           std::vector<unsigned char>& bytes){
+    bool is_signed = isSigned(type);
+    
+    uint64_t min = 0, max = 0;
+    for(size_t i=0; i < values.size(); i++){
+      uint64_t v = 0;
+      if(!toInteger(values[i], type, v))
+        return outOfRange(values[i], type, 64);
+      if(i == 0 || (is_signed ? int64_t(v) < int64_t(min) : v < min))
+        min = v;
+      if(i == 0 || (is_signed ? int64_t(v) > int64_t(max) : v > max))
+        max = v;
+    }
+    
+    int width = values.empty() ? 0 : 1;
+    for(uint64_t range = (max - min) >> 1; range; range >>= 1)
+      width++;
+    
+    bytes.clear();
+    for(uint64_t n = values.size(); ; n >>= 7){
+      bytes.push_back(uint8_t(n & 0x7F) | (n >= 0x80 ? 0x80 : 0));
+      if(n < 0x80)
+        break;
+    }
+    for(int b=0; b < 8; b++)
+      bytes.push_back(uint8_t(min >> (8*b)));
+    bytes.push_back(uint8_t(width));
+    
+    size_t header = bytes.size();
+    bytes.resize(header + (values.size()*width + 7)/8, 0);
+    unsigned char* out = bytes.data() + header;
+    
+    size_t bit = 0;
+    for(auto v: values){
+      uint64_t offset = 0;
+      toInteger(v, type, offset);
+      offset -= min;
+      for(int remaining = width; remaining > 0;){
+        int shift = bit & 7;
+        int take = std::min(8 - shift, remaining);
+        out[bit >> 3] |= uint8_t((offset & ((1u << take) - 1)) << shift);
+        offset >>= take;
+        remaining -= take;
+        bit += take;
+      }
+    }
+    
+    return 0;
+  }
+  
+  // Data of width 0 declares its count without holding the values, it is
+  // accepted only when the expected count is known
+  static int bitPackDecode(const unsigned char* bytes, size_t n_bytes, XidxDataType::NumberType type,
+                           std::vector<double>& values, size_t expected_count = 0){
+    uint64_t count = 0;
+    size_t pos = 0;
+    for(int shift = 0; ; shift += 7){
+      if(pos >= n_bytes || shift > 63){
+        fprintf(stderr, "Truncated bit packed data\n");
+        return 1;
+      }
+      count |= uint64_t(bytes[pos] & 0x7F) << shift;
+      if(!(bytes[pos++] & 0x80))
+        break;
+    }
+    
+    if(pos + 9 > n_bytes){
+      fprintf(stderr, "Truncated bit packed data\n");
+      return 1;
+    }
+    
+    uint64_t min = loadLittleEndian64(bytes+pos, 8);
+    int width = bytes[pos+8];
+    pos += 9;
+    
+    const unsigned char* data = bytes + pos;
+    size_t n_data = n_bytes - pos;
+    if(width > 64 || (width > 0 && count > (n_data*8)/uint64_t(width)) ||
+       (width == 0 && count > 0 && expected_count == 0)){
+      fprintf(stderr, "Invalid bit packed data\n");
+      return 1;
+    }
+    
+    if(expected_count != 0 && count > expected_count){
+      fprintf(stderr, "Bit packed data holds %llu values, more than the %zu expected\n",
+              (unsigned long long)count, expected_count);
+      return 1;
+    }
+    
+    bool is_signed = isSigned(type);
+    size_t offset = values.size();
+    values.resize(offset + count);
+    double* out = values.data() + offset;
+    
+    for(size_t i=0, bit=0; i < count; i++, bit += width)
+      out[i] = toDouble(min + readBits(data, n_data, bit, width), is_signed);
+    
+    return 0;
+  }
+  
+  static std::string base64Encode(const unsigned char* bytes, size_t n_bytes){
+    static const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    
+    std::string text;
+    text.reserve(((n_bytes+2)/3)*4);
+    
+    size_t i=0;
+    for(; i+2 < n_bytes; i+=3){
+      uint32_t triple = (uint32_t(bytes[i]) << 16) | (uint32_t(bytes[i+1]) << 8) | bytes[i+2];
+      text.push_back(alphabet[(triple >> 18) & 0x3F]);
+      text.push_back(alphabet[(triple >> 12) & 0x3F]);
+      text.push_back(alphabet[(triple >> 6) & 0x3F]);
+      text.push_back(alphabet[triple & 0x3F]);
+    }
+    
+    if(i < n_bytes){
+      uint32_t triple = uint32_t(bytes[i]) << 16;
+      if(i+1 < n_bytes)
+        triple |= uint32_t(bytes[i+1]) << 8;
+      
+      text.push_back(alphabet[(triple >> 18) & 0x3F]);
+      text.push_back(alphabet[(triple >> 12) & 0x3F]);
+      text.push_back(i+1 < n_bytes ? alphabet[(triple >> 6) & 0x3F] : '=');
+      text.push_back('=');
+    }
+    
+    return text;
+  }
+  
+  // Decode base64 text, whitespace is ignored
+  static int base64Decode(const char* text, std::vector<unsigned char>& bytes){
+    bytes.clear();
+    bytes.reserve(strlen(text)/4*3);
+    
+    uint32_t quad = 0;
+    int n_sextets = 0;
+    
+    for(const char* c = text; *c; c++){
+      int v = base64Value(*c);
+      if(v == -2) // whitespace
+        continue;
+      if(v == -1){
+        fprintf(stderr, "Invalid base64 character '%c'\n", *c);
+        return 1;
+      }
+      if(v == 64) // padding
+        break;
+      
+      quad = (quad << 6) | v;
+      if(++n_sextets == 4){
+        bytes.push_back((quad >> 16) & 0xFF);
+        bytes.push_back((quad >> 8) & 0xFF);
+        bytes.push_back(quad & 0xFF);
+        quad = 0;
+        n_sextets = 0;
+      }
+    }
+    
+    if(n_sextets == 2)
+      bytes.push_back((quad >> 4) & 0xFF);
+    else if(n_sextets == 3){
+      bytes.push_back((quad >> 10) & 0xFF);
+      bytes.push_back((quad >> 2) & 0xFF);
+    }
+    else if(n_sextets == 1){
+      fprintf(stderr, "Truncated base64 data\n");
+      return 1;
+    }
+    
+    return 0;
+  }
+  
+  static int compress(CompressionType compression, std::vector<unsigned char>& bytes){
+    if(compression == NO_COMPRESSION)
+      return 0;
+    
+#if XIDX_HAVE_ZLIB
+    uLongf n_compressed = compressBound(bytes.size());
+    std::vector<unsigned char> compressed(n_compressed);
+    
+    if(compress2(compressed.data(), &n_compressed, bytes.data(), bytes.size(), Z_BEST_COMPRESSION) != Z_OK){
+      fprintf(stderr, "zlib compression failed\n");
+      return 1;
+    }
+    
+    compressed.resize(n_compressed);
+    bytes.swap(compressed);
+    return 0;
+#else
+    (void)bytes;
+    fprintf(stderr, "Compression %s is not supported by this build\n", toString(compression));
+    return 1;
+#endif
+  }
+  
+  // Inflate data whose uncompressed size is n_bytes, or unknown if 0
+  static int uncompress(CompressionType compression, std::vector<unsigned char>& bytes, size_t n_bytes){
+    if(compression == NO_COMPRESSION)
+      return 0;
+    
+#if XIDX_HAVE_ZLIB
+    if(n_bytes == 0)
+      return inflateAll(bytes);
+    
+    std::vector<unsigned char> uncompressed(n_bytes);
+    uLongf n_uncompressed = n_bytes;
+    
+    if(::uncompress(uncompressed.data(), &n_uncompressed, bytes.data(), bytes.size()) != Z_OK
+       || n_uncompressed != n_bytes){
+      fprintf(stderr, "zlib decompression failed\n");
+      return 1;
+    }
+    
+    bytes.swap(uncompressed);
+    return 0;
+#else
+    (void)bytes; (void)n_bytes;
+    fprintf(stderr, "Compression %s is not supported by this build\n", toString(compression));
+    return 1;
+#endif
+  }
+  
+private:
+  
+#if XIDX_HAVE_ZLIB
+  static int inflateAll(std::vector<unsigned char>& bytes){
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if(inflateInit(&stream) != Z_OK){
+      fprintf(stderr, "zlib decompression failed\n");
+      return 1;
+    }
+    
+    std::vector<unsigned char> uncompressed(bytes.size()*4 + 64);
+    stream.next_in = bytes.data();
+    stream.avail_in = uInt(bytes.size());
+    
+    int ret = Z_OK;
+    while(ret == Z_OK){
+      if(stream.total_out == uncompressed.size())
+        uncompressed.resize(uncompressed.size()*2);
+      stream.next_out = uncompressed.data() + stream.total_out;
+      stream.avail_out = uInt(uncompressed.size() - stream.total_out);
+      ret = inflate(&stream, Z_NO_FLUSH);
+    }
+    
+    uncompressed.resize(stream.total_out);
+    inflateEnd(&stream);
+    
+    if(ret != Z_STREAM_END){
+      fprintf(stderr, "zlib decompression failed\n");
+      return 1;
+    }
+    
+    bytes.swap(uncompressed);
+    return 0;
+  }
+#endif
+  
+  static inline bool isSigned(XidxDataType::NumberType type){
+    return type == XidxDataType::NumberType::CHAR_NUMBER_TYPE || type == XidxDataType::NumberType::INT_NUMBER_TYPE;
+  }
+  
+  // Whether v can be converted to a value of size bytes of the given type,
+  // integers are truncated toward zero
+  static inline bool isInRange(double v, XidxDataType::NumberType type, size_t size){
+    if(type == XidxDataType::NumberType::FLOAT_NUMBER_TYPE)
+      return size == 8 || !std::isfinite(v) || std::fabs(v) <= std::numeric_limits<float>::max();
+    
+    if(std::isnan(v))
+      return false;
+    
+    int bits = int(size*8);
+    if(isSigned(type))
+      return v > -std::ldexp(1.0, bits-1) - 1 && v < std::ldexp(1.0, bits-1);
+    return v > -1 && v < std::ldexp(1.0, bits);
+  }
+  
+  static int outOfRange(double v, XidxDataType::NumberType type, int bit_precision){
+    fprintf(stderr, "Value %g does not fit type %s with precision %d\n", v, XidxDataType::toString(type), bit_precision);
+    return 1;
+  }
+  
+  // Two's complement bits of an integer value, false when v does not fit
+  // a 64 bit integer of the signedness of type
+  static inline bool toInteger(double v, XidxDataType::NumberType type, uint64_t& bits){
+    if(isSigned(type)){
+      if(!(v >= -std::ldexp(1.0, 63) && v < std::ldexp(1.0, 63)))
+        return false;
+      bits = uint64_t(int64_t(v));
+    }
+    else{
+      if(!(v > -1 && v < std::ldexp(1.0, 64)))
+        return false;
+      bits = uint64_t(v);
+    }
+    return true;
+  }
+  
+  static inline double toDouble(uint64_t v, bool is_signed){
+    return is_signed ? double(int64_t(v)) : double(v);
+  }
+  
+  // Little endian word from up to 8 available bytes
+  static inline uint64_t loadLittleEndian64(const unsigned char* in, size_t available){
+    uint64_t v = 0;
+    if(available >= 8 && isHostLittleEndian()){
+      memcpy(&v, in, 8);
+      return v;
+    }
+    for(size_t b=0; b < 8 && b < available; b++)
+      v |= uint64_t(in[b]) << (8*b);
+    return v;
+  }
+  
+  // Read width bits starting at bit, a single unaligned word load when width <= 56
+  static inline uint64_t readBits(const unsigned char* data, size_t n_data, size_t bit, int width){
+    if(width == 0)
+      return 0;
+    if(width > 56)
+      return readBits(data, n_data, bit, 32) | (readBits(data, n_data, bit+32, width-32) << 32);
+    
+    size_t byte = bit >> 3;
+    uint64_t word = loadLittleEndian64(data + byte, n_data - byte);
+    return (word >> (bit & 7)) & ((uint64_t(1) << width) - 1);
+  }
+  
+  static inline int base64Value(char c){
+    if(c >= 'A' && c <= 'Z') return c - 'A';
+    if(c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if(c >= '0' && c <= '9') return c - '0' + 52;
+    if(c == '+') return 62;
+    if(c == '/') return 63;
+    if(c == '=') return 64;
+    if(c == ' ' || c == '\n' || c == '\r' || c == '\t') return -2;
+    return -1;
+  }
+  
+  static inline void swapBytes(unsigned char* bytes, size_t count, size_t size){
+    for(size_t i=0; i < count; i++, bytes += size)
+      std::reverse(bytes, bytes+size);
+  }
+  
+  template<typename T>
+  static inline void store(T v, unsigned char* out){ memcpy(out, &v, sizeof(T)); }
+  
+  template<typename T>
+  static inline double load(const unsigned char* in){ T v; memcpy(&v, in, sizeof(T)); return double(v); }
+  
+  static inline void storeValue(double v, XidxDataType::NumberType type, size_t size, unsigned char* out){
+    switch(type){
+      case XidxDataType::NumberType::FLOAT_NUMBER_TYPE:
+        if(size == 4) store<float>(float(v), out); else store<double>(v, out);
+        break;
+      case XidxDataType::NumberType::CHAR_NUMBER_TYPE:
+      case XidxDataType::NumberType::INT_NUMBER_TYPE:
+        switch(size){
+          case 1: store<int8_t>(int8_t(v), out); break;
+          case 2: store<int16_t>(int16_t(v), out); break;
+          case 4: store<int32_t>(int32_t(v), out); break;
+          default: store<int64_t>(int64_t(v), out); break;
+        }
+        break;
+      default:
+        switch(size){
+          case 1: store<uint8_t>(uint8_t(v), out); break;
+          case 2: store<uint16_t>(uint16_t(v), out); break;
+          case 4: store<uint32_t>(uint32_t(v), out); break;
+          default: store<uint64_t>(uint64_t(v), out); break;
+        }
+    }
+  }
+  
+  static inline double loadValue(const unsigned char* in, XidxDataType::NumberType type, size_t size){
+    switch(type){
+      case XidxDataType::NumberType::FLOAT_NUMBER_TYPE:
+        return size == 4 ? load<float>(in) : load<double>(in);
+      case XidxDataType::NumberType::CHAR_NUMBER_TYPE:
+      case XidxDataType::NumberType::INT_NUMBER_TYPE:
+        switch(size){
+          case 1: return load<int8_t>(in);
+          case 2: return load<int16_t>(in);
+          case 4: return load<int32_t>(in);
+          default: return load<int64_t>(in);
+        }
+      default:
+        switch(size){
+          case 1: return load<uint8_t>(in);
+          case 2: return load<uint16_t>(in);
+          case 4: return load<uint32_t>(in);
+          default: return load<uint64_t>(in);
+        }
+    }
+  }
+  
+};
+
+}
+#endif
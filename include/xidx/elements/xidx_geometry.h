@@ -62,6 +62,11 @@ public:
     }
   }
   
+  static inline bool fromString(const char* s, GeometryType& v){
+    static const NameTable<GeometryType> table(XYZ_GEOMETRY_TYPE, RECT_GEOMETRY_TYPE, toString);
+    return table.find(s, v);
+  }
+  
 public:
   std::string name;
   GeometryType type;
@@ -78,37 +83,38 @@ public:
     items.push_back(item);
   }
 
-  xmlNodePtr serialize(xmlNode *parent, const char *text = NULL) override{
+  int write(ArchiveWriter& writer) override{
 
-    xmlNodePtr geometry_node = xmlNewChild(parent, NULL, BAD_CAST "Geometry", NULL);
-    xmlNewProp(geometry_node, BAD_CAST "Type", BAD_CAST toString(type));
+    writer.beginElement(Element::GEOMETRY_ELEMENT);
+    writer.writeAttribute("Type", toString(type));
     
     for(auto item: items)
-      xmlNodePtr item_node = item.serialize(geometry_node);
+      item.write(writer);
 
-    return geometry_node;
+    return writer.endElement();
   };
   
-  int deserialize(xmlNodePtr node, Parsable *_parent) override{
-    if(!isNodeName(node,"Geometry"))
+  int read(ArchiveReader& reader, Parsable *_parent) override{
+    if(reader.getElement() != Element::GEOMETRY_ELEMENT)
       return -1;
 
     setParent(_parent);
-    //name = xidx::getProp(node, "Name");
+    //name = reader.readAttribute("Name");
             
-    const char* geo_type = xidx::getProp(node, "Type");
+    const char* geo_type = reader.readAttribute("Type");
 
-    for(int t=GeometryType::XYZ_GEOMETRY_TYPE; t <= RECT_GEOMETRY_TYPE; t++)
-      if (strcmp(geo_type, toString(static_cast<GeometryType>(t)))==0)
-          type = static_cast<GeometryType>(t);
+    fromString(geo_type, type);
 
-    for (xmlNode* inner_node = node->children->next; inner_node; inner_node = inner_node->next) {
-      if(isNodeName(inner_node, "DataItem")){
-        DataItem geo_dataitem(this);
-        geo_dataitem.deserialize(inner_node, this);
+    if(reader.firstChild()){
+      do{
+        if(reader.getElement() == Element::DATA_ITEM_ELEMENT){
+          DataItem geo_dataitem(this);
+          geo_dataitem.read(reader, this);
 
-        items.push_back(geo_dataitem);
-      }
+          items.push_back(geo_dataitem);
+        }
+      } while(reader.nextSibling());
+      reader.parent();
     }
 
     return 0;
@@ -116,10 +122,9 @@ public:
   
   size_t getVolume() const{
     size_t total = 1;
-    for(auto item: items){
-      for(int i=0; i < item.dimensions.size(); i++)
-        total *= item.dimensions[i];
-    }
+    for(auto& item: items)
+      if(!multiplyVolume(total, item.getVolume()))
+        return 0;
     return total;
   }
   
@@ -32,6 +32,10 @@
 
 #include "xidx/xidx.h"
 
+#include <libxml/xinclude.h>
+#include <libxml/uri.h>
+#include <algorithm>
+#include <list>
 #include <sys/stat.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -48,7 +52,9 @@ class Variability {
   public:
     enum VariabilityType{
       STATIC_VARIABILITY_TYPE = 0,
-      VARIABLE_VARIABILITY_TYPE = 1
+      VARIABLE_VARIABILITY_TYPE = 1,
+      TEMPLATE_VARIABILITY_TYPE = 2,
+      OVERRIDE_VARIABILITY_TYPE = 3
     };
     
     static inline const char* toString(VariabilityType v)
@@ -57,11 +63,358 @@ class Variability {
       {
         case STATIC_VARIABILITY_TYPE:     return "Static";
         case VARIABLE_VARIABILITY_TYPE:   return "Variable";
+        case TEMPLATE_VARIABILITY_TYPE:   return "Template";
+        case OVERRIDE_VARIABILITY_TYPE:   return "Override";
         default:                          return "[Unknown]";
       }
     }
+    
+    static inline bool fromString(const char* s, VariabilityType& v){
+      static const NameTable<VariabilityType> table(STATIC_VARIABILITY_TYPE, OVERRIDE_VARIABILITY_TYPE, toString);
+      return table.find(s, v);
+    }
+};
+
+// Restricts which children of a temporal group are built when loading
+// a file, either by their index or by their value in the group domain
+class DomainSelection {
+  public:
+    enum SelectionType{
+      ALL_SELECTION_TYPE = 0,
+      INDEX_RANGE_SELECTION_TYPE = 1,
+      TIME_RANGE_SELECTION_TYPE = 2
+    };
+
+    SelectionType type;
+    DomainIndex first;
+    DomainIndex last;   // inclusive, negative means up to the last index
+    PHY_TYPE t_start;
+    PHY_TYPE t_end;
+
+    DomainSelection(){
+      type = ALL_SELECTION_TYPE;
+      first = 0;
+      last = -1;
+      t_start = 0;
+      t_end = 0;
+    }
+
+    static DomainSelection indexRange(DomainIndex _first, DomainIndex _last){
+      DomainSelection sel;
+      sel.type = INDEX_RANGE_SELECTION_TYPE;
+      sel.first = _first;
+      sel.last = _last;
+      return sel;
+    }
+
+    static DomainSelection timeRange(PHY_TYPE _t_start, PHY_TYPE _t_end){
+      DomainSelection sel;
+      sel.type = TIME_RANGE_SELECTION_TYPE;
+      sel.t_start = _t_start;
+      sel.t_end = _t_end;
+      return sel;
+    }
+
+    bool isAll() const { return type == ALL_SELECTION_TYPE; }
+
+    bool containsIndex(DomainIndex i) const {
+      return i >= first && (last < 0 || i <= last);
+    }
+
+    bool containsTime(PHY_TYPE t) const {
+      return t >= t_start && t <= t_end;
+    }
 };
+
+inline bool isIncludeNode(xmlNode *node){
+  if(node->type != XML_ELEMENT_NODE || node->ns == NULL || !isNodeName(node, "include"))
+    return false;
+
+  return xmlStrEqual(node->ns->href, XINCLUDE_NS) || xmlStrEqual(node->ns->href, XINCLUDE_OLD_NS);
+}
+
+// Include that refers to a shared Domain or Variable by ID (see SubtreeTable)
+inline bool isSubtreeReference(xmlNode *node){
+  if(!isIncludeNode(node))
+    return false;
+  
+  const char* xpointer = getProp(node, "xpointer");
+  return xpointer != NULL && strstr(xpointer, "[@ID=") != NULL;
+}
+  
+class Group;
+
+// Reads the children of a group ahead of a sequential or strided walk on a
+// background thread. At most depth children are queued, loading or ready
+// to be taken; a change of stride cancels them.
+class GroupPrefetcher{
+
+public:
+  typedef std::function<std::shared_ptr<Group>(DomainIndex)> Loader;
+  
+  // n_indices bounds the indices read ahead (0 means unbounded)
+  GroupPrefetcher(Loader _load, size_t _depth, DomainIndex _n_indices=0)
+    : load(_load), depth(_depth), n_indices(_n_indices){
+    worker = std::thread([this](){ work(); });
+  }
   
+  ~GroupPrefetcher(){
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+      pending.clear();
+    }
+    cv.notify_all();
+    worker.join();
+  }
+  
+  GroupPrefetcher(const GroupPrefetcher&) = delete;
+  GroupPrefetcher& operator=(const GroupPrefetcher&) = delete;
+  
+  // Record an access to index i and queue the next indices along the
+  // stride, except those is_loaded reports. Returns the group read ahead
+  // for i, if any.
+  std::shared_ptr<Group> access(DomainIndex i, const std::function<bool(DomainIndex)>& is_loaded){
+    std::unique_lock<std::mutex> lock(mutex);
+    
+    // i is being read, waiting is cheaper than reading it again
+    cv.wait(lock, [&](){ return loading != i; });
+    
+    std::shared_ptr<Group> found;
+    auto it = ready.find(i);
+    if(it != ready.end()){
+      found = it->second;
+      ready.erase(it);
+      hits++;
+    }
+    
+    if(has_last){
+      DomainIndex delta = i - last;
+      sequential = delta != 0 && delta == stride;
+      if(delta != stride){
+        if(pending.size() > 0 || ready.size() > 0)
+          cancellations++;
+        pending.clear();
+        ready.clear();
+        generation++;
+        stride = delta;
+      }
+    }
+    has_last = true;
+    last = i;
+    
+    if(sequential)
+      schedule(i, is_loaded);
+    
+    lock.unlock();
+    cv.notify_all();
+    
+    return found;
+  }
+  
+  size_t getNumberOfHits() const { std::lock_guard<std::mutex> lock(mutex); return hits; }
+  size_t getNumberOfCancellations() const { std::lock_guard<std::mutex> lock(mutex); return cancellations; }
+  
+private:
+  Loader load;
+  size_t depth;
+  DomainIndex n_indices;
+  
+  std::thread worker;
+  mutable std::mutex mutex;
+  std::condition_variable cv;
+  bool stopping = false;
+  
+  std::deque<DomainIndex> pending;
+  std::map<DomainIndex, std::shared_ptr<Group> > ready;
+  DomainIndex loading = -1;
+  size_t generation = 0;
+  
+  // access pattern
+  bool has_last = false;
+  bool sequential = false;
+  DomainIndex last = 0;
+  DomainIndex stride = 0;
+  
+  size_t hits = 0;
+  size_t cancellations = 0;
+  
+  // Queue the next depth indices after i, the ones behind are dropped
+  void schedule(DomainIndex i, const std::function<bool(DomainIndex)>& is_loaded){
+    std::vector<DomainIndex> window;
+    for(size_t k=1; k <= depth; k++){
+      long long next = (long long)i + (long long)k*stride;
+      if(next < 0 || (n_indices > 0 && next >= n_indices))
+        break;
+      window.push_back(DomainIndex(next));
+    }
+    
+    auto outside = [&](DomainIndex j){ return std::find(window.begin(), window.end(), j) == window.end(); };
+    for(auto it = ready.begin(); it != ready.end();){
+      if(outside(it->first))
+        it = ready.erase(it);
+      else
+        ++it;
+    }
+    pending.erase(std::remove_if(pending.begin(), pending.end(), outside), pending.end());
+    
+    for(DomainIndex j: window){
+      if(ready.size() + pending.size() + (loading >= 0 ? 1 : 0) >= depth)
+        break;
+      if(ready.count(j) || loading == j || is_loaded(j) ||
+         std::find(pending.begin(), pending.end(), j) != pending.end())
+        continue;
+      pending.push_back(j);
+    }
+  }
+  
+  void work(){
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true){
+      cv.wait(lock, [this](){ return stopping || pending.size() > 0; });
+      if(stopping)
+        return;
+      
+      DomainIndex i = pending.front();
+      pending.pop_front();
+      loading = i;
+      size_t started = generation;
+      
+      lock.unlock();
+      std::shared_ptr<Group> gr = load(i);
+      lock.lock();
+      
+      // results of a cancelled walk are dropped
+      if(gr != nullptr && started == generation && !stopping)
+        ready[i] = gr;
+      loading = -1;
+      cv.notify_all();
+    }
+  }
+};
+
+// Children read on demand by the groups of a file, bounded by an estimate
+// of their memory. The least recently used are evicted and read again when
+// requested.
+class GroupCache{
+
+public:
+  explicit GroupCache(size_t _budget) : budget(_budget){ }
+  
+  GroupCache(const GroupCache&) = delete;
+  GroupCache& operator=(const GroupCache&) = delete;
+  
+  // Child i of owner, counted as a hit or a miss
+  std::shared_ptr<Group> find(const Group* owner, DomainIndex i){
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(Key(owner, i));
+    if(it == index.end()){
+      misses++;
+      return nullptr;
+    }
+    
+    hits++;
+    lru.splice(lru.begin(), lru, it->second);
+    return it->second->group;
+  }
+  
+  bool contains(const Group* owner, DomainIndex i) const{
+    std::lock_guard<std::mutex> lock(mutex);
+    return index.count(Key(owner, i)) > 0;
+  }
+  
+  // Add or update the child i of owner as the most recently used, the
+  // others are evicted while the budget is exceeded
+  void insert(const Group* owner, DomainIndex i, std::shared_ptr<Group> group, size_t bytes){
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(Key(owner, i));
+    if(it != index.end()){
+      size -= it->second->bytes;
+      it->second->group = group;
+      it->second->bytes = bytes;
+      lru.splice(lru.begin(), lru, it->second);
+    }
+    else{
+      lru.push_front(Entry{Key(owner, i), group, bytes});
+      index[Key(owner, i)] = lru.begin();
+    }
+    size += bytes;
+    evict();
+  }
+  
+  // Drop the children of owner, e.g. when it is destroyed
+  void erase(const Group* owner){
+    std::lock_guard<std::mutex> lock(mutex);
+    for(auto it = lru.begin(); it != lru.end();){
+      if(it->key.first == owner){
+        size -= it->bytes;
+        index.erase(it->key);
+        it = lru.erase(it);
+      }
+      else
+        ++it;
+    }
+  }
+  
+  void clear(){
+    std::lock_guard<std::mutex> lock(mutex);
+    lru.clear();
+    index.clear();
+    size = 0;
+  }
+  
+  void setBudget(size_t _budget){
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = _budget;
+    evict();
+  }
+  
+  size_t getBudget() const { std::lock_guard<std::mutex> lock(mutex); return budget; }
+  size_t getSize() const { std::lock_guard<std::mutex> lock(mutex); return size; }
+  size_t getNumberOfEntries() const { std::lock_guard<std::mutex> lock(mutex); return lru.size(); }
+  
+  size_t getNumberOfHits() const { std::lock_guard<std::mutex> lock(mutex); return hits; }
+  size_t getNumberOfMisses() const { std::lock_guard<std::mutex> lock(mutex); return misses; }
+  size_t getNumberOfEvictions() const { std::lock_guard<std::mutex> lock(mutex); return evictions; }
+  
+  void resetCounters(){
+    std::lock_guard<std::mutex> lock(mutex);
+    hits = misses = evictions = 0;
+  }
+  
+private:
+  typedef std::pair<const Group*, DomainIndex> Key;
+  
+  struct Entry{
+    Key key;
+    std::shared_ptr<Group> group;
+    size_t bytes;
+  };
+  
+  // most recently used first
+  std::list<Entry> lru;
+  std::map<Key, std::list<Entry>::iterator> index;
+  mutable std::mutex mutex;
+  
+  size_t budget;
+  size_t size = 0;
+  
+  size_t hits = 0;
+  size_t misses = 0;
+  size_t evictions = 0;
+  
+  // the most recently used entry is kept even if larger than the budget
+  void evict(){
+    while(size > budget && lru.size() > 1){
+      Entry& last = lru.back();
+      size -= last.bytes;
+      index.erase(last.key);
+      lru.pop_back();
+      evictions++;
+    }
+  }
+};
+
 class Group : public Parsable{
 
 public:
@@ -80,11 +433,65 @@ public:
     }
   }
   
+  static inline bool fromString(const char* s, GroupType& v){
+    static const NameTable<GroupType> table(SPATIAL_GROUP_TYPE, TEMPORAL_GROUP_TYPE, toString);
+    return table.find(s, v);
+  }
+  
 private:
   std::shared_ptr<Domain> domain;
   std::vector<std::shared_ptr<Group> > groups;
   std::vector<std::shared_ptr<Variable> > variables;
   std::string filePattern;
+
+  // Children built by a selective load, addressed by their original index
+  DomainSelection selection;
+  bool partially_loaded = false;
+  std::map<DomainIndex, std::shared_ptr<Group> > sparse_groups;
+  
+  // Shared subtrees of the load or save in progress
+  SubtreeTable* subtree_table = nullptr;
+  
+  // Build sibling groups concurrently while deserializing
+  bool parallel_deserialize = false;
+  
+  // Build inline sibling groups concurrently while serializing
+  bool parallel_serialize = false;
+  
+  // Child used for every index of the domain, except where an override
+  // (holding only what changes at that index) is defined
+  std::shared_ptr<Group> template_group;
+  std::map<DomainIndex, std::shared_ptr<Group> > overrides;
+  
+  // Geometry and data source of the children generated from the template,
+  // one row per index
+  std::shared_ptr<GroupTable> table;
+  
+  // Document the group was read from, subfiles are relative to it
+  std::string base_url;
+  DomainIndex n_indices = 0;
+  
+  // Children read on demand are kept here instead of sparse_groups
+  std::shared_ptr<GroupCache> cache;
+  
+  // Changed, with its subtree, since the last load or save
+  bool modified = true;
+  bool deserializing = false;
+  
+  // Unchanged subtrees are not serialized again by an incremental save, the
+  // bytes written the previous time are kept by MetadataFile
+  bool incremental_save = false;
+  std::string saved_xml;
+  friend class MetadataFile;
+  
+  // Copy of the subtree taken by the last snapshot, shared by the next one
+  // while the group is not modified
+  std::shared_ptr<Group> last_snapshot;
+  bool snapshot_stale = true;
+  
+  // Reads children ahead of getGroup, it refers to the members above
+  bool prefetch_headers = false;
+  std::shared_ptr<GroupPrefetcher> prefetcher;
   
 public:
 
@@ -127,11 +534,50 @@ public:
     attributes = g->attributes;
     domain_index = g->domain_index;
     filePattern = g->filePattern;
+    selection = g->selection;
+    partially_loaded = g->partially_loaded;
+    sparse_groups = g->sparse_groups;
+    template_group = g->template_group;
+    overrides = g->overrides;
+    table = g->table;
+    base_url = g->base_url;
+    n_indices = g->n_indices;
+  }
+  
+  ~Group(){
+    prefetcher = nullptr;
+    if(cache != nullptr)
+      cache->erase(this);
   }
   
   inline std::shared_ptr<Domain> getDomain() { return domain; }
   
-  inline int setDomain(std::shared_ptr<Domain> _domain) { domain = _domain; return 0; }
+  inline int setDomain(std::shared_ptr<Domain> _domain) {
+    domain = _domain;
+    if(domain != nullptr && domain->getParent() == nullptr)
+      domain->setParent(this);
+    
+    // subfiles repeat the domain of their parent
+    if(filePattern != "")
+      for(auto g: groups)
+        g->markModifiedSubtree();
+    
+    markModified();
+    return 0;
+  }
+  
+  // Set the value of the attribute with the given name, adding it if missing
+  int setAttribute(std::string att_name, std::string value){
+    for(auto& a: attributes)
+      if(a.name == att_name)
+        return a.setValue(value);
+    
+    Attribute a(att_name, value);
+    a.setParent(this);
+    attributes.push_back(a);
+    markModified();
+    return 0;
+  }
   
   std::shared_ptr<Variable> addVariable(const char *name, XidxDataType::NumberType numberType,
                                         const short bit_precision,
@@ -147,7 +593,7 @@ public:
     
     std::shared_ptr<DataItem> di(new DataItem(this));
     di->number_type = numberType;
-    di->bit_precision = string_format("%d", bit_precision);
+    di->bit_precision = bit_precision;
     di->endian_type = endian;
     if(dimensions.size()>0){
       di->dimensions = std::static_pointer_cast<SpatialDomain>(domain)->topology.dimensions; // Use same dimensions of topology
@@ -169,10 +615,53 @@ public:
   int addDataSource(std::shared_ptr<DataSource> ds) {
     ds->setParent(this);
     data_sources.push_back(ds);
+    markModified();
     return 0;
   }
 
-  const std::shared_ptr<Group>& getGroup(DomainIndex i){
+  // Returned by value (it used to be a const reference into groups): views
+  // of a template and children loaded on demand are not held by the group,
+  // so callers binding the result to a non-const reference need a copy
+  std::shared_ptr<Group> getGroup(DomainIndex i){
+    if(template_group != nullptr)
+      return getTemplateView(i);
+    
+    if(partially_loaded){
+      auto it = sparse_groups.find(i);
+      if(prefetcher == nullptr && cache == nullptr)
+        return it != sparse_groups.end() ? it->second : nullptr;
+      
+      std::shared_ptr<Group> gr;
+      if(prefetcher != nullptr)
+        gr = prefetcher->access(i, [this](DomainIndex j){
+          return sparse_groups.count(j) > 0 || (cache != nullptr && cache->contains(this, j));
+        });
+      if(it != sparse_groups.end())
+        return it->second;
+      
+      if(cache != nullptr){
+        std::shared_ptr<Group> cached = cache->find(this, i);
+        if(cached != nullptr){
+          // decoded values may have grown since it was added
+          cache->insert(this, i, cached, cached->getMemoryUsage());
+          return cached;
+        }
+      }
+      
+      if(gr == nullptr)
+        gr = loadExternalChild(i);
+      if(gr == nullptr)
+        return nullptr;
+      
+      if(cache != nullptr)
+        cache->insert(this, i, gr, gr->getMemoryUsage());
+      else{
+        groups.push_back(gr);
+        sparse_groups[i] = gr;
+      }
+      return gr;
+    }
+
     // TODO check variability of the group
     if(groups.size() == 1)
       return groups.back();
@@ -186,6 +675,67 @@ public:
   }
 
   const std::vector<std::shared_ptr<Group> >& getGroups(){ return groups; }
+
+  // Only the children that fall in the selection will be built by deserialize
+  int setSelection(const DomainSelection& _selection){ selection = _selection; return 0; }
+
+  bool isPartiallyLoaded() const { return partially_loaded; }
+  
+  // For a partially loaded group with its children in subfiles (FilePattern),
+  // getGroup reads the children outside the selection on demand and the next
+  // depth ones along a sequential or strided walk on a background thread,
+  // optionally with the header of their data source (see
+  // DataSource::readHeader). A depth of 0 disables both, unless a cache is set.
+  int setPrefetch(size_t depth, bool payload_headers=false){
+    prefetcher = nullptr;
+    prefetch_headers = payload_headers;
+    if(depth == 0)
+      return 0;
+    
+    Library::init();
+    prefetcher = std::make_shared<GroupPrefetcher>([this](DomainIndex i){
+      std::shared_ptr<Group> gr = loadExternalChild(i);
+      if(gr != nullptr && prefetch_headers && gr->data_sources.size() > 0)
+        gr->data_sources[0]->readHeader();
+      return gr;
+    }, depth, n_indices);
+    
+    return 0;
+  }
+  
+  const std::shared_ptr<GroupPrefetcher>& getPrefetcher() const { return prefetcher; }
+  
+  // Children read on demand are kept in the cache, which may evict them,
+  // rather than in the group (getGroups lists only the loaded selection).
+  // Setting a cache also enables reading on demand.
+  int setCache(std::shared_ptr<GroupCache> _cache){
+    if(cache != nullptr && cache != _cache)
+      cache->erase(this);
+    cache = _cache;
+    return 0;
+  }
+  
+  const std::shared_ptr<GroupCache>& getCache() const { return cache; }
+  
+  // Estimate of the memory held by the group and its subtree, objects
+  // shared within the subtree are counted once
+  size_t getMemoryUsage() const{
+    std::set<const void*> visited;
+    return getMemoryUsage(visited);
+  }
+  
+  // Identical domains and variables are shared while the table is set
+  int setSubtreeTable(SubtreeTable* table){ subtree_table = table; return 0; }
+  
+  // Sibling groups are deserialized on the thread pool, the result is the
+  // one of a serial deserialize. The tree must not change while loading
+  // (i.e., includes already processed).
+  int setParallelDeserialize(bool parallel){ parallel_deserialize = parallel; return 0; }
+  
+  // Inline sibling groups are serialized on the thread pool, the nodes are
+  // attached in order so the document is the one of a serial serialize.
+  // Not used with a subtree table or for children written to other files.
+  int setParallelSerialize(bool parallel){ parallel_serialize = parallel; return 0; }
   
   std::vector<std::shared_ptr<Variable> > getVariables(){ return variables; }
   
@@ -247,21 +797,321 @@ public:
   
   std::shared_ptr<Variable> addVariable(std::shared_ptr<Variable> attribute){
     variables.push_back(attribute);
+    markModified();
     return variables.back();
   }
   
+  // The template is returned by getGroup for every index without an override
+  int setTemplateGroup(std::shared_ptr<Group> group){
+    if(template_group != nullptr)
+      groups.erase(std::find(groups.begin(), groups.end(), template_group));
+    
+    group->variability_type = Variability::VariabilityType::TEMPLATE_VARIABILITY_TYPE;
+    group->domain_index = 0;
+    group->setParent(this);
+    template_group = group;
+    groups.insert(groups.begin(), group);
+    group->markModifiedSubtree();
+    markModified();
+    return 0;
+  }
+  
+  // Elements of delta replace the ones of the template (variables and
+  // attributes by name) for the group at index i
+  int addOverride(DomainIndex i, std::shared_ptr<Group> delta){
+    auto it = overrides.find(i);
+    if(it != overrides.end())
+      groups.erase(std::find(groups.begin(), groups.end(), it->second));
+    
+    delta->variability_type = Variability::VariabilityType::OVERRIDE_VARIABILITY_TYPE;
+    delta->domain_index = i;
+    delta->setParent(this);
+    overrides[i] = delta;
+    groups.push_back(delta);
+    delta->markModifiedSubtree();
+    markModified();
+    return 0;
+  }
+  
+  const std::shared_ptr<Group>& getTemplateGroup() const { return template_group; }
+  
+  const std::map<DomainIndex, std::shared_ptr<Group> >& getOverrides() const { return overrides; }
+  
+  // The rows of the table apply to the template before the overrides
+  int setTable(std::shared_ptr<GroupTable> _table){
+    if(_table != nullptr)
+      _table->setParent(this);
+    table = _table;
+    markModified();
+    return 0;
+  }
+  
+  const std::shared_ptr<GroupTable>& getTable() const { return table; }
+  
+  // Turn the children into the first child as template plus the
+  // differences of the others. Fails, leaving the children as they are, when
+  // a child cannot be written as an override of the first one: it lacks a
+  // domain, data source, variable or attribute of the first child (an
+  // override cannot remove them), or it has another name, type, file pattern
+  // or children of its own.
+  int compactToTemplate(){
+    if(template_group != nullptr || table != nullptr || groups.size() < 2)
+      return 1;
+    
+    for(size_t i=1; i < groups.size(); i++)
+      if(!isOverridable(groups[0].get(), groups[i].get()))
+        return 1;
+    
+    std::vector<std::shared_ptr<Group> > children;
+    children.swap(groups);
+    
+    std::shared_ptr<Group> base = children[0];
+    setTemplateGroup(base);
+    
+    for(size_t i=1; i < children.size(); i++){
+      std::shared_ptr<Group> g = children[i];
+      std::shared_ptr<Group> delta(new Group(g->name, g->group_type));
+      bool changed = false;
+      
+      // the moved elements get the delta as parent, g is released below
+      if(g->domain != nullptr && !sameContent(g->domain.get(), base->domain.get())){
+        delta->domain = g->domain;
+        delta->domain->setParent(delta.get());
+        changed = true;
+      }
+      
+      bool same_sources = g->data_sources.size() == base->data_sources.size();
+      for(size_t d=0; same_sources && d < g->data_sources.size(); d++)
+        same_sources = sameContent(g->data_sources[d].get(), base->data_sources[d].get());
+      if(!same_sources){
+        delta->data_sources = g->data_sources;
+        for(auto& ds: delta->data_sources)
+          ds->setParent(delta.get());
+        changed = true;
+      }
+      
+      for(auto& v: g->variables){
+        auto t = std::find_if(base->variables.begin(), base->variables.end(),
+                              [&v](const std::shared_ptr<Variable>& b){ return b->name == v->name; });
+        if(t == base->variables.end() || !sameContent(v.get(), t->get())){
+          v->setParent(delta.get());
+          delta->variables.push_back(v);
+          changed = true;
+        }
+      }
+      
+      for(auto& a: g->attributes){
+        auto t = std::find_if(base->attributes.begin(), base->attributes.end(),
+                              [&a](const Attribute& b){ return b.name == a.name && b.value == a.value; });
+        if(t == base->attributes.end()){
+          delta->attributes.push_back(a);
+          changed = true;
+        }
+      }
+      
+      if(changed)
+        addOverride(g->variability_type == Variability::VariabilityType::VARIABLE_VARIABILITY_TYPE ? g->domain_index : DomainIndex(i), delta);
+    }
+    
+    return 0;
+  }
+  
+  // Whether an override of base can describe g: it only replaces or adds
+  // elements of base, by name for the variables and the attributes
+  static bool isOverridable(const Group* base, const Group* g){
+    if(g->name != base->name || g->group_type != base->group_type || g->filePattern != base->filePattern ||
+       g->groups.size() > 0 || g->table != nullptr ||
+       (base->domain != nullptr && g->domain == nullptr) ||
+       (base->data_sources.size() > 0 && g->data_sources.empty()))
+      return false;
+    
+    for(auto& v: base->variables)
+      if(std::find_if(g->variables.begin(), g->variables.end(),
+                      [&v](const std::shared_ptr<Variable>& b){ return b->name == v->name; }) == g->variables.end())
+        return false;
+    
+    for(auto& a: base->attributes)
+      if(std::find_if(g->attributes.begin(), g->attributes.end(),
+                      [&a](const Attribute& b){ return b.name == a.name; }) == g->attributes.end())
+        return false;
+    
+    return true;
+  }
+  
+  // Turn children that differ only by the values of their geometry and by
+  // their data source into the first child as template plus a table
+  int compactToTable(){
+    if(template_group != nullptr || groups.size() < 2)
+      return 1;
+    
+    std::shared_ptr<Group> base = groups[0];
+    std::shared_ptr<SpatialDomain> base_domain = std::dynamic_pointer_cast<SpatialDomain>(base->domain);
+    if(base_domain == nullptr || base->data_sources.size() > 1)
+      return 1;
+    
+    std::vector<size_t> widths;
+    for(auto& item: base_domain->geometry.items)
+      widths.push_back(item.getValues().size());
+    
+    bool same_source_names = true;
+    for(auto& g: groups){
+      std::shared_ptr<SpatialDomain> dom = std::dynamic_pointer_cast<SpatialDomain>(g->domain);
+      if(dom == nullptr || dom->name != base_domain->name || g->name != base->name ||
+         g->group_type != base->group_type || g->groups.size() > 0 || g->filePattern != "" ||
+         dom->geometry.type != base_domain->geometry.type || dom->geometry.items.size() != widths.size() ||
+         !sameContent(&dom->topology, &base_domain->topology) ||
+         g->data_sources.size() != base->data_sources.size() ||
+         g->variables.size() != base->variables.size() || g->attributes.size() != base->attributes.size())
+        return 1;
+      
+      for(size_t c=0; c < widths.size(); c++)
+        if(dom->geometry.items[c].format_type != DataItem::FormatType::XML_FORMAT ||
+           dom->geometry.items[c].getValues().size() != widths[c])
+          return 1;
+      
+      for(size_t v=0; v < g->variables.size(); v++)
+        if(!sameContent(g->variables[v].get(), base->variables[v].get()))
+          return 1;
+      
+      for(size_t a=0; a < g->attributes.size(); a++)
+        if(g->attributes[a].name != base->attributes[a].name || g->attributes[a].value != base->attributes[a].value)
+          return 1;
+      
+      if(g->data_sources.size() > 0 && g->data_sources[0]->name != base->data_sources[0]->name)
+        same_source_names = false;
+    }
+    
+    std::shared_ptr<GroupTable> t(new GroupTable(widths));
+    std::vector<double> row;
+    for(auto& g: groups){
+      row.clear();
+      for(auto& item: std::static_pointer_cast<SpatialDomain>(g->domain)->geometry.items)
+        row.insert(row.end(), item.getValues().begin(), item.getValues().end());
+      
+      if(g->data_sources.size() > 0)
+        t->addRow(row, g->data_sources[0]->getUrl(), same_source_names ? "" : g->data_sources[0]->name);
+      else
+        t->addRow(row);
+    }
+    
+    std::vector<std::shared_ptr<Group> >().swap(groups);
+    setTemplateGroup(base);
+    setTable(t);
+    
+    return 0;
+  }
+  
+  // Children of a group with a template or a table are its overrides (see
+  // addOverride), adding other children to it fails
   int addGroup(std::shared_ptr<Group> group, DomainIndex=0){
+    if(template_group != nullptr || table != nullptr){
+      fprintf(stderr, "Group %s has a template, children are added as overrides\n", name.c_str());
+      return 1;
+    }
+    
     if(group->variability_type == Variability::VariabilityType::VARIABLE_VARIABILITY_TYPE){
       group->domain_index = groups.size();
     }
     
     group->setParent(this);
     groups.push_back(group);
+    group->markModifiedSubtree();
+    markModified();
     return 0;
   }
   
+  // Mark the group, and the groups containing it, as changed since the last
+  // load or save. Mutators do it, it is needed after editing public members
+  // (e.g., attributes). A shared domain or variable marks only its parent.
+  void markModified() override{
+    if(deserializing)
+      return;
+    
+    modified = true;
+    snapshot_stale = true;
+    std::string().swap(saved_xml);
+    Parsable::markModified();
+  }
+  
+  // Changed since the last load or save, including its subtree
+  bool isModified() const { return modified; }
+  
+  // Copy of the subtree that is not changed by later edits of the group, to
+  // be saved on another thread (see MetadataFile::saveAsync). The groups not
+  // modified since the previous snapshot share their copy with it, the others
+  // are copied with their own domain, variables, data sources and table.
+  std::shared_ptr<Group> snapshot(){
+    if(!snapshot_stale && last_snapshot != nullptr)
+      return last_snapshot;
+    
+    std::shared_ptr<Group> copy(new Group(this));
+    // the copy may be shared by the snapshots of several parents
+    copy->setParent(nullptr);
+    copy->modified = modified;
+    
+    if(domain != nullptr){
+      copy->domain = copyDomain(domain.get());
+      if(copy->domain != nullptr)
+        copy->domain->setParent(copy.get());
+      else
+        fprintf(stderr, "Domain %s of group %s cannot be copied, it is left out of the snapshot\n",
+                domain->name.c_str(), name.c_str());
+    }
+    
+    for(auto& v: copy->variables){
+      v = std::make_shared<Variable>(*v);
+      v->detach();
+      v->setParent(copy.get());
+    }
+    
+    if(table != nullptr){
+      copy->table = std::make_shared<GroupTable>(*table);
+      copy->table->setParent(copy.get());
+    }
+    
+    for(auto& ds: copy->data_sources){
+      ds = std::make_shared<DataSource>(ds.get());
+      ds->setParent(copy.get());
+    }
+    
+    for(auto& a: copy->attributes)
+      a.setParent(copy.get());
+    
+    for(auto& g: copy->groups){
+      bool is_template = g == template_group;
+      g = g->snapshot();
+      if(is_template)
+        copy->template_group = g;
+    }
+    
+    for(auto& o: copy->overrides)
+      o.second = o.second->snapshot();
+    
+    for(auto& g: copy->sparse_groups)
+      g.second = g.second->snapshot();
+    
+    last_snapshot = copy;
+    snapshot_stale = false;
+    return copy;
+  }
+  
+  // Mark the subtree as saved, done by MetadataFile after writing it
+  void clearModified(){
+    modified = false;
+    for(auto g: groups)
+      g->clearModified();
+  }
+  
+  // Skip the subfiles of unchanged children and splice the bytes previously
+  // written for unchanged inline children (see MetadataFile::setIncrementalSave)
+  int setIncrementalSave(bool incremental){ incremental_save = incremental; return 0; }
+  
   xmlNodePtr serialize(xmlNode *parent, const char *text = NULL) override{
 
+    // the placeholder is replaced by the bytes saved the previous time
+    if(incremental_save && !modified && saved_xml.size() > 0 && subtree_table == nullptr)
+      return xmlAddChild(parent, xmlNewDocComment(parent->doc, BAD_CAST savedPlaceholder()));
+    
     xmlNodePtr group_node = xmlNewChild(parent, NULL, BAD_CAST "Group", NULL);
     xmlNewProp(group_node, BAD_CAST "Name", BAD_CAST name.c_str());
     xmlNewProp(group_node, BAD_CAST "Type", BAD_CAST toString(group_type));
@@ -270,26 +1120,71 @@ public:
     if(filePattern!="")
       xmlNewProp(group_node, BAD_CAST "FilePattern", BAD_CAST filePattern.c_str());
     
-    if(variability_type == Variability::VariabilityType::VARIABLE_VARIABILITY_TYPE)
+    if(variability_type == Variability::VariabilityType::VARIABLE_VARIABILITY_TYPE ||
+       variability_type == Variability::VariabilityType::OVERRIDE_VARIABILITY_TYPE)
       xmlNewProp(group_node, BAD_CAST "DomainIndex", BAD_CAST std::to_string(domain_index).c_str());
     
     for(auto data: data_sources)
       xmlNodePtr data_node = data->serialize(group_node);
     
-    xmlNodePtr domain_node = domain->serialize(group_node);
+    // an override may keep the domain of the template
+    if(domain != nullptr){
+      xmlNodePtr domain_node = serializeShared(domain.get(), group_node);
+      if(subtree_table != nullptr)
+        domain_node = subtree_table->reference(domain_node, "domain", getDataSourceContext());
+    }
 
     for(auto a:attributes)
       xmlNodePtr a_node = a.serialize(group_node);
     
-    for(auto v:variables)
-      xmlNodePtr v_node = v->serialize(group_node);
+    for(auto v:variables){
+      xmlNodePtr v_node = serializeShared(v.get(), group_node);
+      if(subtree_table != nullptr)
+        v_node = subtree_table->reference(v_node, "variable", getDataSourceContext());
+    }
+    
+    if(table != nullptr)
+      table->serialize(group_node);
+    
+    // each child is built under its own scratch node and then moved here,
+    // the document is shared unless its dictionary would be
+    if(parallel_serialize && subtree_table == nullptr && groups.size() > 1 &&
+       (filePattern == "" || template_group != nullptr)){
+      xmlDocPtr doc = (group_node->doc != NULL && group_node->doc->dict == NULL) ? group_node->doc : NULL;
+      std::vector<xmlNodePtr> scratch(groups.size());
+      for(auto g:groups){
+        g->setParallelSerialize(true);
+        g->setIncrementalSave(incremental_save);
+      }
+      
+      ThreadPool::global().parallelFor(groups.size(), [&](size_t i){
+        scratch[i] = xmlNewDocNode(doc, NULL, BAD_CAST "Scratch", NULL);
+        groups[i]->serialize(scratch[i]);
+      });
+      
+      for(size_t i=0; i < groups.size(); i++){
+        groups[i]->setParallelSerialize(false);
+        groups[i]->setIncrementalSave(false);
+        xmlNodePtr g_node = scratch[i]->children;
+        xmlUnlinkNode(g_node);
+        xmlAddChild(group_node, g_node);
+        xmlFreeNode(scratch[i]);
+      }
+      
+      return group_node;
+    }
       
     for(auto g:groups){
+      g->setSubtreeTable(subtree_table);
+      g->setParallelSerialize(parallel_serialize);
+      g->setIncrementalSave(incremental_save);
+      
       xmlNodePtr group_ref = NULL;
       
       xmlNodePtr parent_group = NULL;
       
-      if(filePattern!="")
+      // template and overrides are always written inline
+      if(filePattern!="" && template_group == nullptr)
       {
         std::string filePath = string_format(filePattern+"/meta.xidx", g->domain_index);
         
@@ -297,7 +1192,18 @@ public:
         xmlNewProp(group_ref, BAD_CAST "href", BAD_CAST filePath.c_str());
         xmlNewProp(group_ref, BAD_CAST "xpointer", BAD_CAST "xpointer(//Xidx/Group/Group)");
         
+        // the subfile of an unchanged child is still current
+        struct stat file_stat;
+        if(incremental_save && !g->modified && stat(filePath.c_str(), &file_stat) == 0){
+          g->setSubtreeTable(nullptr);
+          g->setParallelSerialize(false);
+          g->setIncrementalSave(false);
+          continue;
+        }
+        
         parent_group = ResolveExternalNode(filePattern, this);
+        xmlFree((xmlChar*)parent_group->doc->URL);
+        parent_group->doc->URL = xmlStrdup(BAD_CAST filePath.c_str());
         
         xmlNodePtr g_node = g->serialize(parent_group);
         
@@ -321,6 +1227,10 @@ public:
       }
       else
         xmlNodePtr g_node = g->serialize(group_node);
+      
+      g->setSubtreeTable(nullptr);
+      g->setParallelSerialize(false);
+      g->setIncrementalSave(false);
     }
 
     return group_node;
@@ -330,6 +1240,33 @@ public:
     if(!isNodeName(node,"Group"))
       return -1;
     
+    deserializing = true;
+    int ret = deserializeGroup(node, _parent);
+    deserializing = false;
+    modified = false;
+    std::string().swap(saved_xml);
+    
+    return ret;
+  }
+  
+  // Content of the comment written in place of an unchanged group
+  static const char* savedPlaceholder(){ return "xidx-saved"; }
+  
+protected:
+  
+  int deserializeGroup(_xmlNode *node, Parsable *_parent){
+    // siblings are built without the table, their domains and variables
+    // are then shared in document order as a serial deserialize does
+    if(parallel_deserialize && subtree_table != nullptr && selection.isAll()){
+      SubtreeTable* table = subtree_table;
+      subtree_table = nullptr;
+      int ret = deserialize(node, _parent);
+      subtree_table = table;
+      if(ret == 0)
+        internSubtrees(node);
+      return ret;
+    }
+    
     setParent(_parent);
   
     name = xidx::getProp(node, "Name");
@@ -337,14 +1274,10 @@ public:
     //assert(this->getParent()!=nullptr);
     
     const char* type_s = xidx::getProp(node, "Type");
-    for(int t=GroupType::SPATIAL_GROUP_TYPE; t <= GroupType::TEMPORAL_GROUP_TYPE; t++)
-      if (strcmp(type_s, toString(static_cast<GroupType>(t)))==0)
-             group_type = static_cast<GroupType>(t);
+    fromString(type_s, group_type);
 
     const char* vtype_s = xidx::getProp(node, "VariabilityType");
-    for(int t=Variability::VariabilityType::STATIC_VARIABILITY_TYPE; t <= Variability::VariabilityType::VARIABLE_VARIABILITY_TYPE; t++)
-      if (strcmp(vtype_s, Variability::toString(static_cast<Variability::VariabilityType>(t)))==0)
-        variability_type = static_cast<Variability::VariabilityType>(t);
+    Variability::fromString(vtype_s, variability_type);
     
     const char* dindex_s = xidx::getProp(node, "DomainIndex");
     
@@ -357,64 +1290,320 @@ public:
     else
       domain_index = 0;
 
+    // A selection is resolved only when there are multiple children to choose from,
+    // a template and its overrides are always loaded entirely
+    int n_children = 0;
+    if(!selection.isAll()){
+      for (xmlNode* cur_node = node->children; cur_node; cur_node = cur_node->next)
+        if((isIncludeNode(cur_node) && !isSubtreeReference(cur_node)) ||
+           elementOf(cur_node) == Element::GROUP_ELEMENT){
+          n_children++;
+          
+          if(isTemplateNode(cur_node)){
+            n_children = 0;
+            break;
+          }
+        }
+    }
+    partially_loaded = n_children > 1;
+    n_indices = partially_loaded ? n_children : 0;
+    sparse_groups.clear();
+    
+    if(node->doc != NULL && node->doc->URL != NULL)
+      base_url = (const char*)node->doc->URL;
+    template_group = nullptr;
+    overrides.clear();
+    table = nullptr;
+
+    DomainIndex child_index = 0;
+    DomainIndex included_index = 0;
+    bool included_child = false;
+    std::vector<xmlNode*> parallel_nodes;
+
     for (xmlNode* cur_node = node->children->next; cur_node; cur_node = cur_node->next) {
       
-      if(isNodeName(cur_node,"DataSource")){
+      Element::ElementType element = elementOf(cur_node);
+      
+      if(isSubtreeReference(cur_node)){
+        // the referenced domain or variable is processed at the next iteration
+        if(xmlXIncludeProcessTreeFlags(cur_node, XML_PARSE_XINCLUDE | XML_PARSE_HUGE) < 0)
+          fprintf(stderr, "XInclude processing failed for a shared subtree\n");
+      }
+      else if(partially_loaded && isIncludeNode(cur_node)){
+        // the index is taken even if the include fails, so that the
+        // following children keep theirs
+        DomainIndex index = child_index++;
+        if(isSelected(index, n_children)){
+          // the included group is processed at the next iteration
+          if(xmlXIncludeProcessTreeFlags(cur_node, XML_PARSE_XINCLUDE | XML_PARSE_HUGE) < 0)
+            fprintf(stderr, "XInclude processing failed for child %d\n", index);
+          else{
+            included_child = true;
+            included_index = index;
+          }
+        }
+      }
+      else if(element == Element::DATA_SOURCE_ELEMENT){
         std::shared_ptr<DataSource> ds(new DataSource());
         ds->deserialize(cur_node, this);
         data_sources.push_back(ds);
       }
-      else if(isNodeName(cur_node,"Domain")){
-        const char* domtype_s = xidx::getProp(cur_node, "Type");
-        Domain::DomainType dom_type;
-        
-        for(int t=Domain::DomainType::HYPER_SLAB_DOMAIN_TYPE; t <= Domain::DomainType::RANGE_DOMAIN_TYPE; t++)
-          if (strcmp(domtype_s, Domain::toString(static_cast<Domain::DomainType>(t)))==0)
-            dom_type = static_cast<Domain::DomainType>(t);
-
-        switch(dom_type){
-          case Domain::DomainType::HYPER_SLAB_DOMAIN_TYPE:
-            domain = std::make_shared<HyperSlabDomain>(new HyperSlabDomain(""));
-            break;
-          case Domain::DomainType::LIST_DOMAIN_TYPE:
-            domain = std::make_shared<ListDomain<PHY_TYPE>>(new ListDomain<PHY_TYPE>(""));
-            break;
-          case Domain::DomainType::MULTIAXIS_DOMAIN_TYPE:
-            domain = std::make_shared<MultiAxisDomain>(new MultiAxisDomain(""));
-            break;
-          case Domain::DomainType::SPATIAL_DOMAIN_TYPE:
-            domain = std::make_shared<SpatialDomain>(new SpatialDomain(""));
-            break;
-          case Domain::DomainType::RANGE_DOMAIN_TYPE:
-            fprintf(stderr, "Range domain not implemented yet\n");
-            break;
+      else if(element == Element::DOMAIN_ELEMENT){
+        SubtreeKey key;
+        std::shared_ptr<Domain> shared;
+        if(subtree_table != nullptr){
+          key = SubtreeTable::keyOf(cur_node, getDataSourceContext());
+          shared = subtree_table->find<Domain>(key);
         }
         
-        if(domain != nullptr)
+        domain = createDomain(xidx::getProp(cur_node, "Type"));
+        
+        // a key is only a hash, the subtree is shared when it is equal
+        if(domain != nullptr){
           domain->deserialize(cur_node, this);
+          if(shared != nullptr && sameContent(domain.get(), shared.get()))
+            domain = shared;
+          else if(subtree_table != nullptr && shared == nullptr)
+            subtree_table->insert(key, domain);
+        }
       }
-      else if(isNodeName(cur_node,"Attribute")){
+      else if(element == Element::TABLE_ELEMENT){
+        table = std::make_shared<GroupTable>();
+        if(table->deserialize(cur_node, this) != 0){
+          fprintf(stderr, "Invalid table of group %s, it is ignored\n", name.c_str());
+          table = nullptr;
+        }
+      }
+      else if(element == Element::ATTRIBUTE_ELEMENT){
         Attribute att;
         att.deserialize(cur_node, this);
         attributes.push_back(att);
       }
-      else if(isNodeName(cur_node,"Variable")){
+      else if(element == Element::VARIABLE_ELEMENT){
+        SubtreeKey key;
+        std::shared_ptr<Variable> shared;
+        if(subtree_table != nullptr){
+          key = SubtreeTable::keyOf(cur_node, getDataSourceContext());
+          shared = subtree_table->find<Variable>(key);
+        }
+        
         std::shared_ptr<Variable> var(new Variable(this));
         var->deserialize(cur_node, this);
+        if(shared != nullptr && sameContent(var.get(), shared.get()))
+          var = shared;
+        else if(subtree_table != nullptr && shared == nullptr)
+          subtree_table->insert(key, var);
         variables.push_back(var);
         
         //printf("added var %s parent %s\n", variables.back()->name.c_str(), variables.back()->parent->name.c_str());
       }
-      else if(isNodeName(cur_node,"Group")){
-        std::shared_ptr<Group> gr(new Group(""));
-        gr->deserialize(cur_node, this);
-        groups.push_back(gr);
+      else if(element == Element::GROUP_ELEMENT){
+        if(partially_loaded){
+          DomainIndex index = included_child ? included_index : child_index++;
+          if(!included_child && !isSelected(index, n_children))
+            continue;
+          included_child = false;
+
+          // nested includes are not expanded by a selective load
+          xmlXIncludeProcessTreeFlags(cur_node, XML_PARSE_XINCLUDE | XML_PARSE_HUGE);
+
+          std::shared_ptr<Group> gr(new Group(""));
+          gr->setSubtreeTable(subtree_table);
+          gr->deserialize(cur_node, this);
+          gr->setSubtreeTable(nullptr);
+          groups.push_back(gr);
+          sparse_groups[index] = gr;
+        }
+        else if(parallel_deserialize)
+          parallel_nodes.push_back(cur_node);
+        else{
+          std::shared_ptr<Group> gr(new Group(""));
+          gr->setSubtreeTable(subtree_table);
+          gr->deserialize(cur_node, this);
+          gr->setSubtreeTable(nullptr);
+          addDeserializedGroup(gr);
+        }
       }
     }
     
+    // the children are built without the subtree table, the group that holds
+    // it shares their domains and variables afterwards (see the start of this
+    // function). An exception thrown by a child is rethrown here once all of
+    // them are done, as a serial deserialize would let it through.
+    if(parallel_nodes.size() > 0){
+      std::vector<std::shared_ptr<Group> > built(parallel_nodes.size());
+      ThreadPool::global().parallelFor(parallel_nodes.size(), [&](size_t i){
+        std::shared_ptr<Group> gr(new Group(""));
+        gr->setParallelDeserialize(true);
+        gr->deserialize(parallel_nodes[i], this);
+        gr->setParallelDeserialize(false);
+        built[i] = gr;
+      });
+      
+      for(auto& gr: built)
+        addDeserializedGroup(gr);
+    }
+    
     return 0;
   };
   
+public:
+  
+  // Write the tree through an archive, read back by read. serialize and
+  // deserialize do not go through them, the features that need XML are
+  // missing from other backends (see BufferArchive):
+  // - the children of a file pattern are written inline, nothing is included
+  // - a partially loaded group keeps the indices of its loaded children, the
+  //   others cannot be read on demand without the files
+  // - shared domains and variables (setShareOnLoad, setSubtreeTable) are
+  //   written once per use and read back as copies
+  // - the bytes kept for an incremental save are not written, the next
+  //   incremental save writes the whole tree
+  // - the children are read serially, parallel load applies only to XML
+  virtual int write(ArchiveWriter& writer) override{
+    writer.beginElement(Element::GROUP_ELEMENT);
+    writer.writeAttribute("Name", name.c_str());
+    writer.writeAttribute("Type", toString(group_type));
+    writer.writeAttribute("VariabilityType", Variability::toString(variability_type));
+    
+    if(filePattern!="")
+      writer.writeAttribute("FilePattern", filePattern.c_str());
+    
+    if(variability_type == Variability::VariabilityType::VARIABLE_VARIABILITY_TYPE ||
+       variability_type == Variability::VariabilityType::OVERRIDE_VARIABILITY_TYPE)
+      writer.writeAttribute("DomainIndex", std::to_string(domain_index).c_str());
+    
+    if(partially_loaded){
+      std::string loaded;
+      for(auto& g: sparse_groups)
+        loaded += std::to_string(g.first) + " ";
+      writer.writeAttribute("IndexCount", std::to_string(n_indices).c_str());
+      writer.writeAttribute("LoadedIndices", loaded.c_str());
+    }
+    
+    for(auto data: data_sources)
+      data->write(writer);
+    
+    if(domain != nullptr)
+      domain->write(writer);
+    
+    for(auto& a: attributes)
+      a.write(writer);
+    
+    for(auto v: variables)
+      v->write(writer);
+    
+    if(table != nullptr)
+      table->write(writer);
+    
+    if(partially_loaded){
+      for(auto& g: sparse_groups)
+        g.second->write(writer);
+    }
+    else{
+      for(auto g: groups)
+        g->write(writer);
+    }
+    
+    return writer.endElement();
+  }
+  
+  virtual int read(ArchiveReader& reader, Parsable *_parent) override{
+    if(reader.getElement() != Element::GROUP_ELEMENT)
+      return -1;
+    
+    deserializing = true;
+    setParent(_parent);
+    
+    const char* name_s = reader.readAttribute("Name");
+    name = name_s != nullptr ? name_s : "";
+    
+    fromString(reader.readAttribute("Type"), group_type);
+    Variability::fromString(reader.readAttribute("VariabilityType"), variability_type);
+    
+    const char* fpattern_s = reader.readAttribute("FilePattern");
+    if(fpattern_s != nullptr)
+      filePattern = fpattern_s;
+    
+    const char* dindex_s = reader.readAttribute("DomainIndex");
+    domain_index = dindex_s != nullptr ? atoi(dindex_s) : 0;
+    
+    // the loaded children of a partially loaded group, in order
+    std::vector<DomainIndex> loaded;
+    const char* count_s = reader.readAttribute("IndexCount");
+    const char* loaded_s = reader.readAttribute("LoadedIndices");
+    if(count_s != nullptr && loaded_s != nullptr){
+      std::stringstream stream(loaded_s);
+      for(DomainIndex i; stream >> i;)
+        loaded.push_back(i);
+    }
+    
+    partially_loaded = count_s != nullptr;
+    n_indices = count_s != nullptr ? atoi(count_s) : 0;
+    sparse_groups.clear();
+    template_group = nullptr;
+    overrides.clear();
+    table = nullptr;
+    
+    size_t n_loaded = 0;
+    if(reader.firstChild()){
+      do{
+        switch(reader.getElement()){
+          case Element::DATA_SOURCE_ELEMENT:{
+            std::shared_ptr<DataSource> ds(new DataSource());
+            ds->read(reader, this);
+            data_sources.push_back(ds);
+            break;
+          }
+          case Element::DOMAIN_ELEMENT:
+            domain = createDomain(reader.readAttribute("Type"));
+            if(domain != nullptr)
+              domain->read(reader, this);
+            break;
+          case Element::TABLE_ELEMENT:
+            table = std::make_shared<GroupTable>();
+            if(table->read(reader, this) != 0){
+              fprintf(stderr, "Invalid table of group %s, it is ignored\n", name.c_str());
+              table = nullptr;
+            }
+            break;
+          case Element::ATTRIBUTE_ELEMENT:{
+            Attribute att;
+            att.read(reader, this);
+            attributes.push_back(att);
+            break;
+          }
+          case Element::VARIABLE_ELEMENT:{
+            std::shared_ptr<Variable> var(new Variable(this));
+            var->read(reader, this);
+            variables.push_back(var);
+            break;
+          }
+          case Element::GROUP_ELEMENT:{
+            std::shared_ptr<Group> gr(new Group(""));
+            gr->read(reader, this);
+            if(!partially_loaded)
+              addDeserializedGroup(gr);
+            else if(n_loaded < loaded.size()){
+              groups.push_back(gr);
+              sparse_groups[loaded[n_loaded++]] = gr;
+            }
+            break;
+          }
+          default:
+            break;
+        }
+      } while(reader.nextSibling());
+      reader.parent();
+    }
+    
+    deserializing = false;
+    modified = false;
+    std::string().swap(saved_xml);
+    
+    return 0;
+  }
+  
   virtual std::string getClassName() const override { return "Group"; };
   
   virtual Parsable* findChild(const std::string &class_name) const override {
@@ -425,6 +1614,436 @@ public:
   }
   
 protected:
+
+  static size_t getMemoryUsage(const std::vector<std::shared_ptr<DataItem> >& items, std::set<const void*>& visited){
+    size_t bytes = items.capacity()*sizeof(std::shared_ptr<DataItem>);
+    for(auto& item: items)
+      if(item != nullptr && visited.insert(item.get()).second)
+        bytes += item->getMemoryUsage();
+    return bytes;
+  }
+  
+  size_t getMemoryUsage(std::set<const void*>& visited) const{
+    size_t bytes = sizeof(Group) + name.capacity() + filePattern.capacity();
+    
+    if(domain != nullptr && visited.insert(domain.get()).second)
+      bytes += sizeof(Domain) + getMemoryUsage(domain->data_items, visited);
+    
+    for(auto& v: variables)
+      if(visited.insert(v.get()).second)
+        bytes += sizeof(Variable) + v->name.capacity() + getMemoryUsage(v->getDataItems(), visited);
+    
+    for(auto& ds: data_sources)
+      if(visited.insert(ds.get()).second)
+        bytes += sizeof(DataSource) + ds->getUrl().capacity();
+    
+    for(auto& g: groups)
+      if(visited.insert(g.get()).second)
+        bytes += g->getMemoryUsage(visited);
+    
+    if(template_group != nullptr && visited.insert(template_group.get()).second)
+      bytes += template_group->getMemoryUsage(visited);
+    for(auto& o: overrides)
+      if(visited.insert(o.second.get()).second)
+        bytes += o.second->getMemoryUsage(visited);
+    
+    return bytes;
+  }
+  
+  // Empty domain of the given type, nullptr for an unknown type
+  static std::shared_ptr<Domain> createDomain(const char* type_s){
+    Domain::DomainType dom_type;
+    if(!Domain::fromString(type_s, dom_type))
+      return nullptr;
+    
+    switch(dom_type){
+      case Domain::DomainType::HYPER_SLAB_DOMAIN_TYPE:
+        return std::make_shared<HyperSlabDomain>(new HyperSlabDomain(""));
+      case Domain::DomainType::LIST_DOMAIN_TYPE:
+        return std::make_shared<ListDomain<PHY_TYPE>>(new ListDomain<PHY_TYPE>(""));
+      case Domain::DomainType::MULTIAXIS_DOMAIN_TYPE:
+        return std::make_shared<MultiAxisDomain>(new MultiAxisDomain(""));
+      case Domain::DomainType::SPATIAL_DOMAIN_TYPE:
+        return std::make_shared<SpatialDomain>(new SpatialDomain(""));
+      case Domain::DomainType::RANGE_DOMAIN_TYPE:
+        return std::make_shared<RangeDomain>("");
+    }
+    
+    return nullptr;
+  }
+  
+  // Domains and variables may be shared by siblings serialized concurrently
+  // and some of them rebuild their data items while serializing, so in
+  // parallel mode each object is written by one thread at a time. Decoding
+  // values may start a loop on the pool, which must not pick up the
+  // serialization of another sibling while the lock is held.
+  xmlNodePtr serializeShared(Parsable* p, xmlNode* parent){
+    if(!parallel_serialize)
+      return p->serialize(parent);
+    
+    static std::mutex locks[64];
+    std::lock_guard<std::mutex> lock(locks[(reinterpret_cast<uintptr_t>(p) >> 4) % 64]);
+    ThreadPool::OwnTasksOnly own_tasks_only;
+    return p->serialize(parent);
+  }
+  
+  // Mark the subtree as changed without marking the parents
+  void markModifiedSubtree(){
+    modified = true;
+    snapshot_stale = true;
+    std::string().swap(saved_xml);
+    for(auto g: groups)
+      g->markModifiedSubtree();
+  }
+  
+  void addDeserializedGroup(std::shared_ptr<Group> gr){
+    groups.push_back(gr);
+    
+    if(gr->variability_type == Variability::VariabilityType::TEMPLATE_VARIABILITY_TYPE)
+      template_group = gr;
+    else if(gr->variability_type == Variability::VariabilityType::OVERRIDE_VARIABILITY_TYPE)
+      overrides[gr->domain_index] = gr;
+  }
+  
+  // Share the domains and variables of a subtree deserialized without the
+  // table, visiting the nodes in the order used by deserialize
+  void internSubtrees(xmlNode* node){
+    size_t v = 0, g = 0;
+    
+    for (xmlNode* cur_node = node->children->next; cur_node; cur_node = cur_node->next) {
+      Element::ElementType element = elementOf(cur_node);
+      
+      if(element == Element::DOMAIN_ELEMENT && domain != nullptr){
+        SubtreeKey key = SubtreeTable::keyOf(cur_node, getDataSourceContext());
+        std::shared_ptr<Domain> shared = subtree_table->find<Domain>(key);
+        if(shared == nullptr)
+          subtree_table->insert(key, domain);
+        else if(sameContent(domain.get(), shared.get()))
+          domain = shared;
+      }
+      else if(element == Element::VARIABLE_ELEMENT && v < variables.size()){
+        SubtreeKey key = SubtreeTable::keyOf(cur_node, getDataSourceContext());
+        std::shared_ptr<Variable> shared = subtree_table->find<Variable>(key);
+        if(shared == nullptr)
+          subtree_table->insert(key, variables[v]);
+        else if(sameContent(variables[v].get(), shared.get()))
+          variables[v] = shared;
+        v++;
+      }
+      else if(element == Element::GROUP_ELEMENT && g < groups.size()){
+        groups[g]->setSubtreeTable(subtree_table);
+        groups[g]->internSubtrees(cur_node);
+        groups[g]->setSubtreeTable(nullptr);
+        g++;
+      }
+    }
+  }
+  
+  static bool isTemplateNode(xmlNode* node){
+    if(node->type != XML_ELEMENT_NODE || !isNodeName(node, "Group"))
+      return false;
+    
+    const char* vtype = getProp(node, "VariabilityType");
+    return vtype != NULL &&
+      (strcmp(vtype, Variability::toString(Variability::VariabilityType::TEMPLATE_VARIABILITY_TYPE)) == 0 ||
+       strcmp(vtype, Variability::toString(Variability::VariabilityType::OVERRIDE_VARIABILITY_TYPE)) == 0);
+  }
+  
+  // Field-wise comparisons of elements, differences that do not matter
+  // (e.g. list values kept only in the data item) may report false
+  static bool sameAttributes(const std::vector<Attribute>& a, const std::vector<Attribute>& b){
+    if(a.size() != b.size())
+      return false;
+    for(size_t i=0; i < a.size(); i++)
+      if(a[i].name != b[i].name || a[i].value != b[i].value)
+        return false;
+    return true;
+  }
+  
+  static bool sameAttributes(const std::vector<std::shared_ptr<Attribute> >& a,
+                             const std::vector<std::shared_ptr<Attribute> >& b){
+    if(a.size() != b.size())
+      return false;
+    for(size_t i=0; i < a.size(); i++)
+      if(a[i]->name != b[i]->name || a[i]->value != b[i]->value)
+        return false;
+    return true;
+  }
+  
+  static bool sameContent(DataSource* a, DataSource* b){
+    if(a == b)
+      return true;
+    if(a == nullptr || b == nullptr)
+      return false;
+    return a->name == b->name && a->getUrl() == b->getUrl();
+  }
+  
+  static bool sameContent(const DataItem& a, const DataItem& b){
+    if(a.name != b.name || a.dimensions.size() != b.dimensions.size() ||
+       a.number_type != b.number_type || a.bit_precision != b.bit_precision ||
+       a.n_components != b.n_components || a.endian_type != b.endian_type ||
+       a.format_type != b.format_type || a.encoding_type != b.encoding_type ||
+       a.compression_type != b.compression_type || a.getReference() != b.getReference() ||
+       !sameAttributes(a.getAttributes(), b.getAttributes()) ||
+       !sameContent(a.data_source.get(), b.data_source.get()))
+      return false;
+    
+    for(size_t i=0; i < a.dimensions.size(); i++)
+      if(a.dimensions[i] != b.dimensions[i])
+        return false;
+    
+    return a.sameValues(b);
+  }
+  
+  static bool sameContent(const std::vector<std::shared_ptr<DataItem> >& a,
+                          const std::vector<std::shared_ptr<DataItem> >& b){
+    if(a.size() != b.size())
+      return false;
+    for(size_t i=0; i < a.size(); i++)
+      if(a[i] != b[i] && (a[i] == nullptr || b[i] == nullptr || !sameContent(*a[i], *b[i])))
+        return false;
+    return true;
+  }
+  
+  static bool sameContent(const std::vector<DataItem>& a, const std::vector<DataItem>& b){
+    if(a.size() != b.size())
+      return false;
+    for(size_t i=0; i < a.size(); i++)
+      if(!sameContent(a[i], b[i]))
+        return false;
+    return true;
+  }
+  
+  static bool sameContent(Topology* a, Topology* b){
+    if(a->type != b->type || a->dimensions.size() != b->dimensions.size() ||
+       !sameAttributes(a->attributes, b->attributes) || !sameContent(a->items, b->items))
+      return false;
+    for(size_t i=0; i < a->dimensions.size(); i++)
+      if(a->dimensions[i] != b->dimensions[i])
+        return false;
+    return true;
+  }
+  
+  static bool sameContent(Variable* a, Variable* b){
+    if(a == b)
+      return true;
+    if(a == nullptr || b == nullptr)
+      return false;
+    return a->name == b->name && a->center_type == b->center_type &&
+      sameAttributes(a->getAttributes(), b->getAttributes()) && sameContent(a->getDataItems(), b->getDataItems());
+  }
+  
+  static bool sameContent(Domain* a, Domain* b){
+    if(a == b)
+      return true;
+    if(a == nullptr || b == nullptr)
+      return false;
+    if(a->getClassName() != b->getClassName() || a->getType() != b->getType() || a->name != b->name ||
+       !sameAttributes(a->getAttributes(), b->getAttributes()) || !sameContent(a->data_items, b->data_items))
+      return false;
+    
+    switch(a->getType()){
+      case Domain::DomainType::LIST_DOMAIN_TYPE:{
+        ListDomain<PHY_TYPE>* list_a = dynamic_cast<ListDomain<PHY_TYPE>*>(a);
+        ListDomain<PHY_TYPE>* list_b = dynamic_cast<ListDomain<PHY_TYPE>*>(b);
+        return list_a == nullptr || list_b == nullptr || list_a->values_vector == list_b->values_vector;
+      }
+      case Domain::DomainType::RANGE_DOMAIN_TYPE:{
+        RangeDomain* range_a = static_cast<RangeDomain*>(a);
+        RangeDomain* range_b = static_cast<RangeDomain*>(b);
+        return range_a->getMin() == range_b->getMin() && range_a->getMax() == range_b->getMax() &&
+          range_a->getStep() == range_b->getStep();
+      }
+      case Domain::DomainType::MULTIAXIS_DOMAIN_TYPE:{
+        MultiAxisDomain* multi_a = static_cast<MultiAxisDomain*>(a);
+        MultiAxisDomain* multi_b = static_cast<MultiAxisDomain*>(b);
+        if(multi_a->getNumberOfAxis() != multi_b->getNumberOfAxis())
+          return false;
+        for(int i=0; i < multi_a->getNumberOfAxis(); i++)
+          if(!sameContent(const_cast<Variable*>(&multi_a->getAxis(i)), const_cast<Variable*>(&multi_b->getAxis(i))))
+            return false;
+        return true;
+      }
+      case Domain::DomainType::SPATIAL_DOMAIN_TYPE:{
+        SpatialDomain* spatial_a = static_cast<SpatialDomain*>(a);
+        SpatialDomain* spatial_b = static_cast<SpatialDomain*>(b);
+        return sameContent(&spatial_a->topology, &spatial_b->topology) &&
+          spatial_a->geometry.name == spatial_b->geometry.name &&
+          spatial_a->geometry.type == spatial_b->geometry.type &&
+          sameContent(spatial_a->geometry.items, spatial_b->geometry.items);
+      }
+      default:
+        return true;
+    }
+  }
+  
+  // Compose the template with the table row and the override at index i, the
+  // variables are cloned into the view so that they resolve its data source
+  std::shared_ptr<Group> getTemplateView(DomainIndex i){
+    auto it = overrides.find(i);
+    bool has_row = table != nullptr && i >= 0 && size_t(i) < table->getNumberOfRows();
+    if(it == overrides.end() && !has_row)
+      return template_group;
+    
+    std::shared_ptr<Group> view(new Group(template_group.get()));
+    view->setParent(this);
+    view->variability_type = Variability::VariabilityType::VARIABLE_VARIABILITY_TYPE;
+    view->domain_index = i;
+    
+    if(has_row)
+      applyTableRow(view.get(), i);
+    
+    if(it != overrides.end())
+      applyOverride(view.get(), it->second.get());
+    
+    for(auto& v: view->variables){
+      v = std::make_shared<Variable>(v.get());
+      v->setParent(view.get());
+    }
+    
+    return view;
+  }
+  
+  // Domain with its own data items and attributes, null for an unknown type
+  static std::shared_ptr<Domain> copyDomain(Domain* d){
+    std::shared_ptr<Domain> copy;
+    switch(d->getType()){
+      case Domain::DomainType::HYPER_SLAB_DOMAIN_TYPE:
+        copy = std::make_shared<HyperSlabDomain>(static_cast<HyperSlabDomain*>(d));
+        break;
+      case Domain::DomainType::LIST_DOMAIN_TYPE:
+        copy = std::make_shared<ListDomain<PHY_TYPE> >(static_cast<ListDomain<PHY_TYPE>*>(d));
+        break;
+      case Domain::DomainType::MULTIAXIS_DOMAIN_TYPE:
+        copy = std::make_shared<MultiAxisDomain>(static_cast<MultiAxisDomain*>(d));
+        break;
+      case Domain::DomainType::SPATIAL_DOMAIN_TYPE:
+        copy = std::make_shared<SpatialDomain>(static_cast<SpatialDomain*>(d));
+        break;
+      case Domain::DomainType::RANGE_DOMAIN_TYPE:
+        copy = std::make_shared<RangeDomain>(static_cast<RangeDomain*>(d));
+        break;
+      default:
+        return nullptr;
+    }
+    
+    copy->detach();
+    return copy;
+  }
+  
+  void applyTableRow(Group* view, DomainIndex i) const{
+    std::shared_ptr<SpatialDomain> dom = std::dynamic_pointer_cast<SpatialDomain>(view->domain);
+    if(dom != nullptr){
+      dom = std::make_shared<SpatialDomain>(dom.get());
+      for(size_t c=0; c < dom->geometry.items.size() && c < table->getNumberOfColumns(); c++)
+        dom->geometry.items[c].setValues(table->getGeometry(i, c));
+      view->domain = dom;
+    }
+    
+    if(view->data_sources.size() > 0 && table->hasUrls()){
+      std::shared_ptr<DataSource> ds(new DataSource(view->data_sources[0].get()));
+      ds->setFilePath(table->getUrl(i));
+      if(table->hasSourceNames())
+        ds->name = table->getSourceName(i);
+      ds->setParent(view);
+      view->data_sources[0] = ds;
+    }
+  }
+  
+  void applyOverride(Group* view, const Group* delta) const{
+    if(delta->domain != nullptr)
+      view->domain = delta->domain;
+    
+    if(delta->data_sources.size() > 0)
+      view->data_sources = delta->data_sources;
+    
+    for(auto& a: delta->attributes){
+      auto t = std::find_if(view->attributes.begin(), view->attributes.end(),
+                            [&a](const Attribute& b){ return b.name == a.name; });
+      if(t != view->attributes.end())
+        *t = a;
+      else
+        view->attributes.push_back(a);
+    }
+    
+    for(auto& v: delta->variables){
+      auto t = std::find_if(view->variables.begin(), view->variables.end(),
+                            [&v](const std::shared_ptr<Variable>& b){ return b->name == v->name; });
+      if(t != view->variables.end())
+        *t = v;
+      else
+        view->variables.push_back(v);
+    }
+  }
+
+  // Identify the data source used by the data items that do not define one
+  std::string getDataSourceContext() const {
+    const Parsable* group = this;
+    while(group != nullptr){
+      const Group* g = static_cast<const Group*>(group);
+      if(g->data_sources.size() > 0)
+        return g->data_sources[0]->name + "\n" + g->data_sources[0]->getUrl();
+      group = findParent("Group", g->getParent());
+    }
+    return "";
+  }
+
+  // Evaluate the selection for the child at index i using the group domain
+  bool isSelected(DomainIndex i, int n_children){
+    if(selection.type == DomainSelection::INDEX_RANGE_SELECTION_TYPE)
+      return selection.containsIndex(i);
+
+    // ranges are evaluated without expanding their values, the children of a
+    // continuous range cover equal consecutive parts of it
+    if(domain != nullptr && domain->getType() == Domain::DomainType::RANGE_DOMAIN_TYPE){
+      std::shared_ptr<RangeDomain> range = std::static_pointer_cast<RangeDomain>(domain);
+      if(i < 0)
+        return true;
+      if(range->isStepped())
+        return size_t(i) >= range->getNumberOfIndices() || selection.containsTime(range->getValue(i));
+      if(i >= n_children)
+        return true;
+      return range->overlapsPart(selection.t_start, selection.t_end, i, n_children);
+    }
+
+    if(domain == nullptr || (domain->getType() != Domain::DomainType::LIST_DOMAIN_TYPE &&
+                             domain->getType() != Domain::DomainType::HYPER_SLAB_DOMAIN_TYPE))
+      return true;
+
+    // lists of tuples (e.g., bounds) use the first value of each tuple
+    size_t stride = valuesPerChild(n_children);
+    if(stride == 0){
+      if(i == 0)
+        fprintf(stderr, "Warning: the domain of group %s does not map to its children, all of them are loaded\n",
+                name.c_str());
+      return true;
+    }
+
+    const IndexSpace& space = domain->getLinearizedIndexSpace();
+    size_t pos = size_t(i)*stride;
+    if(pos >= space.size())
+      return true;
+
+    return selection.containsTime(space[pos]);
+  }
+  
+  // Values of the list domain per child, from the dimensions of its data
+  // item: a list written with Dimensions="n 2" holds a pair for each of the
+  // n children. 0 when the first dimension is not the number of children.
+  size_t valuesPerChild(int n_children) const{
+    if(domain->getType() != Domain::DomainType::LIST_DOMAIN_TYPE || domain->data_items.empty())
+      return 1;
+    
+    const IndexVector& dims = domain->data_items[0]->dimensions;
+    if(dims.size() <= 1)
+      return 1;
+    
+    if(dims[0] != INDEX_TYPE(n_children))
+      return 0;
+    
+    size_t volume = domain->data_items[0]->getVolume();
+    return volume > 0 ? volume / n_children : 0;
+  }
   
   virtual std::string getDataSourceXPath() override {
     if(getParent() == nullptr)
@@ -439,6 +2058,45 @@ protected:
     return xpath_prefix;
   };
   
+  // Read the child at index i from its subfile, as the include written by
+  // serialize would. Only the group read is touched, so that it can run
+  // on the prefetch thread.
+  std::shared_ptr<Group> loadExternalChild(DomainIndex i){
+    if(filePattern == "")
+      return nullptr;
+    
+    std::string href = string_format(filePattern+"/meta.xidx", i);
+    xmlChar* uri = xmlBuildURI(BAD_CAST href.c_str(), base_url != "" ? BAD_CAST base_url.c_str() : NULL);
+    std::string path = uri != NULL ? (const char*)uri : href;
+    xmlFree(uri);
+    
+    xmlDocPtr doc = xmlCtxtReadFile(Library::parserContext(), path.c_str(), NULL, XML_PARSE_XINCLUDE | XML_PARSE_HUGE);
+    if(doc == NULL){
+      fprintf(stderr, "Failed to parse %s\n", path.c_str());
+      return nullptr;
+    }
+    xmlXIncludeProcessFlags(doc, XML_PARSE_XINCLUDE | XML_PARSE_HUGE);
+    
+    // the child is the group inside the copy of this group (//Xidx/Group/Group)
+    xmlNodePtr child = NULL;
+    for(xmlNodePtr n = xmlDocGetRootElement(doc)->children; n && child == NULL; n = n->next)
+      if(elementOf(n) == Element::GROUP_ELEMENT)
+        for(xmlNodePtr c = n->children; c && child == NULL; c = c->next)
+          if(elementOf(c) == Element::GROUP_ELEMENT)
+            child = c;
+    
+    std::shared_ptr<Group> gr;
+    if(child != NULL){
+      gr = std::make_shared<Group>("");
+      gr->deserialize(child, this);
+    }
+    else
+      fprintf(stderr, "No group found in %s\n", path.c_str());
+    
+    xmlFreeDoc(doc);
+    return gr;
+  }
+  
   xmlNodePtr ResolveExternalNode(std::string filePath, const Parsable* parent)
   {
     xmlDocPtr doc = NULL;//= xmlReadFile(filePath.c_str(), NULL, 0);
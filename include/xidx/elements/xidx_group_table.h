@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2017 University of Utah
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef XIDX_GROUP_TABLE_H_
+#define XIDX_GROUP_TABLE_H_
+
+#include "xidx/xidx.h"
+
+namespace xidx{
+
+// Per-index values of a group whose children differ only by their geometry
+// and data source, stored as contiguous columns: one column for each
+// geometry data item (e.g., box, or origin and spacing), one for the data
+// source urls and, when they change too, one for the data source names.
+class GroupTable : public Parsable{
+
+private:
+  
+  // Strings of all the rows concatenated, row r is [offsets[r], offsets[r+1])
+  struct StringColumn{
+    std::string chars;
+    std::vector<uint64_t> offsets = std::vector<uint64_t>(1, 0);
+    
+    void add(const std::string& s){ chars += s; offsets.push_back(chars.size()); }
+    
+    std::string get(size_t row) const{
+      if(row+1 >= offsets.size())
+        return "";
+      return chars.substr(offsets[row], offsets[row+1]-offsets[row]);
+    }
+    
+    void clear(){ chars.clear(); offsets.assign(1, 0); }
+  };
+  
+  size_t n_rows = 0;
+  std::vector<size_t> widths;
+  std::vector<std::vector<double> > geometry_columns;
+  StringColumn urls;
+  StringColumn source_names;
+  
+public:
+  
+  GroupTable(){ name = "Table"; }
+  
+  // Number of values of each geometry data item
+  GroupTable(const std::vector<size_t>& _widths) : widths(_widths), geometry_columns(_widths.size()){
+    name = "Table";
+  }
+  
+  size_t getNumberOfRows() const { return n_rows; }
+  
+  size_t getNumberOfColumns() const { return geometry_columns.size(); }
+  
+  size_t getWidth(size_t column) const { return widths[column]; }
+  
+  // geometry holds the values of all the geometry data items of the row,
+  // an empty source name keeps the one of the template
+  int addRow(const std::vector<double>& geometry, const std::string& url="", const std::string& source_name=""){
+    size_t total = 0;
+    for(auto w: widths)
+      total += w;
+    
+    if(geometry.size() != total){
+      fprintf(stderr, "Table row has %zu geometry values, %zu expected\n", geometry.size(), total);
+      return 1;
+    }
+    
+    size_t pos = 0;
+    for(size_t c=0; c < widths.size(); c++){
+      geometry_columns[c].insert(geometry_columns[c].end(), geometry.begin()+pos, geometry.begin()+pos+widths[c]);
+      pos += widths[c];
+    }
+    
+    urls.add(url);
+    source_names.add(source_name);
+    n_rows++;
+    markModified();
+    
+    return 0;
+  }
+  
+  // Values of a geometry data item at row, empty if out of the table
+  std::vector<double> getGeometry(size_t row, size_t column) const{
+    if(row >= n_rows || column >= geometry_columns.size() ||
+       geometry_columns[column].size() < (row+1)*widths[column])
+      return std::vector<double>();
+    
+    const double* first = geometry_columns[column].data() + row*widths[column];
+    return std::vector<double>(first, first + widths[column]);
+  }
+  
+  std::string getUrl(size_t row) const { return urls.get(row); }
+  
+  std::string getSourceName(size_t row) const { return source_names.get(row); }
+  
+  bool hasUrls() const { return urls.chars.size() > 0; }
+  
+  bool hasSourceNames() const { return source_names.chars.size() > 0; }
+  
+  virtual int write(ArchiveWriter& writer) override{
+    writer.beginElement(Element::TABLE_ELEMENT);
+    writer.writeAttribute("Rows", std::to_string(n_rows).c_str());
+    
+    Encoding::CompressionType compression = Encoding::isCompressionSupported(Encoding::CompressionType::ZLIB_COMPRESSION) ?
+      Encoding::CompressionType::ZLIB_COMPRESSION : Encoding::CompressionType::NO_COMPRESSION;
+    
+    for(size_t c=0; c < geometry_columns.size(); c++){
+      DataItem item(this);
+      item.name = "Geometry";
+      item.number_type = XidxDataType::NumberType::FLOAT_NUMBER_TYPE;
+      item.bit_precision = 64;
+      item.dimensions.push_back(n_rows);
+      item.dimensions.push_back(widths[c]);
+      item.setValues(geometry_columns[c]);
+      item.setEncoding(Encoding::EncodingType::BASE64_ENCODING, compression);
+      item.write(writer);
+    }
+    
+    if(hasUrls())
+      writeStrings(writer, "Url", urls, compression);
+    if(hasSourceNames())
+      writeStrings(writer, "SourceName", source_names, compression);
+    
+    return writer.endElement();
+  }
+  
+  // A column that does not have a value for every row is an error, the
+  // table should then be dropped
+  virtual int read(ArchiveReader& reader, Parsable *_parent) override{
+    if(reader.getElement() != Element::TABLE_ELEMENT)
+      return -1;
+    
+    setParent(_parent);
+    
+    const char* rows_s = reader.readAttribute("Rows");
+    n_rows = rows_s != NULL ? strtoull(rows_s, NULL, 10) : 0;
+    
+    widths.clear();
+    geometry_columns.clear();
+    urls.clear();
+    source_names.clear();
+    
+    if(!reader.firstChild())
+      return 0;
+    
+    int ret = 0;
+    do{
+      if(reader.getElement() != Element::DATA_ITEM_ELEMENT)
+        continue;
+      
+      DataItem item(this);
+      item.read(reader, this);
+      
+      if(item.name == "Url")
+        ret |= readStrings(item, urls);
+      else if(item.name == "SourceName")
+        ret |= readStrings(item, source_names);
+      else{
+        widths.push_back(item.dimensions.size() > 1 ? item.dimensions[1] : 1);
+        geometry_columns.push_back(item.getValues());
+        
+        size_t expected = n_rows;
+        if(!multiplyVolume(expected, widths.back()) || geometry_columns.back().size() != expected){
+          fprintf(stderr, "Table column %zu has %zu values, %zu rows of %zu expected\n", geometry_columns.size()-1,
+                  geometry_columns.back().size(), n_rows, widths.back());
+          ret = 1;
+        }
+      }
+    } while(reader.nextSibling());
+    reader.parent();
+    
+    return ret;
+  }
+  
+  virtual std::string getClassName() const override { return "Table"; };
+  
+private:
+  
+  // Strings are written one per line as bytes
+  int writeStrings(ArchiveWriter& writer, const char* item_name, const StringColumn& column,
+                   Encoding::CompressionType compression){
+    std::vector<unsigned char> bytes;
+    bytes.reserve(column.chars.size() + n_rows);
+    for(size_t r=0; r < n_rows; r++){
+      bytes.insert(bytes.end(), column.chars.begin()+column.offsets[r], column.chars.begin()+column.offsets[r+1]);
+      bytes.push_back('\n');
+    }
+    
+    DataItem item(this);
+    item.name = item_name;
+    item.number_type = XidxDataType::NumberType::UCHAR_NUMBER_TYPE;
+    item.bit_precision = 8;
+    item.dimensions.push_back(bytes.size());
+    if(Encoding::compress(compression, bytes) != 0)
+      return 1;
+    item.setEncodedText(Encoding::base64Encode(bytes.data(), bytes.size()), Encoding::EncodingType::BASE64_ENCODING, compression);
+    item.write(writer);
+    
+    return 0;
+  }
+  
+  int readStrings(const DataItem& item, StringColumn& column){
+    std::vector<unsigned char> bytes;
+    if(Encoding::base64Decode(item.getText().c_str(), bytes) != 0 ||
+       Encoding::uncompress(item.compression_type, bytes, item.getVolume()) != 0){
+      fprintf(stderr, "Failed to decode the table column %s\n", item.name.c_str());
+      return 1;
+    }
+    
+    column.chars.reserve(bytes.size());
+    for(auto b: bytes){
+      if(b == '\n')
+        column.offsets.push_back(column.chars.size());
+      else
+        column.chars.push_back(char(b));
+    }
+    
+    if(column.offsets.size() != n_rows+1){
+      fprintf(stderr, "Table column %s has %zu rows, %zu expected\n", item.name.c_str(), column.offsets.size()-1, n_rows);
+      column.clear();
+      return 1;
+    }
+    
+    return 0;
+  }
+  
+};
+
+}
+
+#endif
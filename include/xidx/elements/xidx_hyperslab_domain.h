@@ -45,80 +45,78 @@ public:
     
     physical->format_type = DataItem::FormatType::XML_FORMAT;
     physical->number_type = XidxDataType::NumberType::FLOAT_NUMBER_TYPE;
-    physical->bit_precision = "64";
+    physical->bit_precision = 64;
   }
   
   HyperSlabDomain(const HyperSlabDomain* d) : ListDomain(d->name){
     type = DomainType::HYPER_SLAB_DOMAIN_TYPE;
     data_items = d->data_items;
+    attributes = d->attributes;
+    bound_size = d->bound_size;
+    slabs = d->slabs;
   }
   
+  // dims values as (start, step, count), multiple triples describe consecutive segments
   int setDomain(uint32_t dims, double* phy_hyperslab){
     assert(data_items.size() >= 1);
     std::shared_ptr<DataItem> physical = data_items[0];
     
+    physical->clearValues();
     physical->dimensions = toIndexVector(string_format("%d", dims));
     
+    std::string text;
     for(int i=0; i< dims; i++){
-      physical->text += std::to_string(phy_hyperslab[i]) +" ";
+      text += std::to_string(phy_hyperslab[i]) +" ";
     }
     
-    trim(physical->text);
+    trim(text);
+    physical->setText(text);
     
+    slabs.assign(phy_hyperslab, phy_hyperslab + dims);
+    
+    markModified();
     return 0;
   }
   
   virtual const IndexSpace& getLinearizedIndexSpace() override{
-    values_vector.resize(count);
+    values_vector.clear();
     
-    for(int i=0; i< count; i++){
-      values_vector[i] = start + i*step;
+    for(size_t s=0; s+2 < slabs.size(); s+=3){
+      double start = slabs[s];
+      double step  = slabs[s+1];
+      size_t count = size_t(slabs[s+2]);
+      
+      for(size_t i=0; i< count; i++)
+        values_vector.push_back(start + i*step);
     }
     return values_vector;
   };
   
-  virtual xmlNodePtr serialize(xmlNode* parent, const char* text=NULL) override{
+  virtual int write(ArchiveWriter& writer) override{
     assert(data_items.size() >= 1);
     type = DomainType::HYPER_SLAB_DOMAIN_TYPE;
-    xmlNodePtr domain_ptr = Domain::serialize(parent);
-
-    return domain_ptr;
+    return Domain::write(writer);
   };
   
-  virtual int deserialize(xmlNodePtr node, Parsable* _parent) override{
+  virtual int read(ArchiveReader& reader, Parsable* _parent) override{
     assert(data_items.size() >= 1);
     setParent(_parent);
     std::shared_ptr<DataItem> physical = data_items[0];
     
-    for (xmlNode* cur_node = node->children->next; cur_node; cur_node = cur_node->next) {
-      //for (xmlNode* inner_node = cur_node->children->next; inner_node; inner_node = inner_node->next) {
-        if (cur_node->type == XML_ELEMENT_NODE) {
-          
-          if(isNodeName(cur_node, "DataItem")){
-            physical->deserialize(cur_node, this);
-          }
+    if(reader.firstChild()){
+      do{
+        if(reader.getElement() == Element::DATA_ITEM_ELEMENT){
+          physical->read(reader, this);
         }
-      //}
+      } while(reader.nextSibling());
+      reader.parent();
     }
     
-    assert(physical->dimensions[0]==3);
-    
-    std::string s = physical->text;
-    std::string delimiter = " ";
-    
-    size_t pos = 0;
-    std::string tokens[3];
-    int c=0;
-    while ((pos = s.find(delimiter)) != std::string::npos) {
-      tokens[c] = s.substr(0, pos);
-      
-      s.erase(0, pos + delimiter.length());
-      c++;
-    }
+    // one (start, step, count) triple for each segment
+    const std::vector<double>& hyperslab = physical->getValues();
+    assert(hyperslab.size() >= 3 && hyperslab.size() % 3 == 0);
     
-    start = stof(tokens[0]);
-    step  = stof(tokens[1]);
-    count = stoi(s);
+    slabs = hyperslab;
 
     return 0;
   };
@@ -130,9 +128,7 @@ public:
   std::vector<std::shared_ptr<Attribute>> getAttributes() const{ return attributes; }
 
 private:
-  double start = 0;
-  double step  = 0;
-  int    count = 0;
+  std::vector<double> slabs;
   
 };
   
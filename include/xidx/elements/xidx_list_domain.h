@@ -32,6 +32,7 @@
 
 #include <sstream>
 #include "xidx/xidx.h"
+#include "xidx_parse_utils.h"
 
 namespace xidx{
 
@@ -61,6 +62,9 @@ public:
   ListDomain(const ListDomain* d) : Domain(d->name){
     type = LIST_DOMAIN_TYPE;
     data_items = d->data_items;
+    attributes = d->attributes;
+    bound_size = d->bound_size;
+    compact_on_save = d->compact_on_save;
     values_vector = d->values_vector;
   }
   
@@ -71,43 +75,70 @@ public:
   }
   
   int addDomainItems(std::vector<T> vals){
+    loadValues();
     values_vector.insert(values_vector.end(), vals.begin(), vals.end());
     bound_size = vals.size();
     
+    markModified();
     return 0;
   }
   
+  // Write arithmetic progressions, or runs of them, as a HyperSlab domain
+  int setCompactOnSave(bool compact){ compact_on_save = compact; return 0; }
+  
   int addDomainItem(T phy){
+    loadValues();
     values_vector.push_back(phy);
+    markModified();
     return 0;
   }
   
   virtual const IndexSpace& getLinearizedIndexSpace() override{
+    // a deserialized list uses the values of its data item until it is
+    // modified, unless they do not match its dimensions
+    if(values_vector.empty() && data_items.size() == 1){
+      const IndexSpace& loaded = data_items[0]->getValues();
+      if(data_items[0]->dimensions.size() == 0 || loaded.size() == data_items[0]->getVolume())
+        return loaded;
+      loadValues();
+    }
+    
     return values_vector;
   };
   
-  virtual xmlNodePtr serialize(xmlNode *parent, const char *text = NULL) override{
+  virtual int write(ArchiveWriter& writer) override{
     assert(data_items.size() >= 1);
     auto physical = data_items[0];
-    physical->text="";
+    
+    if(compact_on_save && std::is_arithmetic<T>::value && bound_size == 1 && physical->dimensions.size() <= 1){
+      std::vector<double> runs = findRuns(getLinearizedIndexSpace());
+      if(runs.size() > 0)
+        return writeRuns(writer, runs);
+    }
+    
+    // nothing to write back if the loaded values were never modified
+    if(values_vector.empty() && physical->getVolume() > 0)
+      return Domain::write(writer);
+    
+    physical->clearValues();
     physical->dimensions.clear();
     physical->dimensions.push_back(values_vector.size()/bound_size);
     if(bound_size > 1)
       physical->dimensions.push_back(bound_size);
     
+    std::string text;
     if(!std::is_same<T, DataSource>::value){
       for(auto phy: values_vector)
-        physical->text+=std::to_string(phy)+" ";
+        text+=std::to_string(phy)+" ";
     }
     
-    trim(physical->text);
-    xmlNodePtr domain_node = Domain::serialize(parent, text);
-      
-    return domain_node;
+    trim(text);
+    physical->setText(text);
+    return Domain::write(writer);
   }
   
-  virtual int deserialize(xmlNodePtr node, Parsable *_parent) override{
-    Domain::deserialize(node, _parent);
+  virtual int read(ArchiveReader& reader, Parsable *_parent) override{
+    Domain::read(reader, _parent);
     
     setParent(_parent);
   
@@ -115,21 +146,11 @@ public:
       
     int count = data_items.size();
   
+    // values are decoded from the data item on first access
+    values_vector.clear();
+    
     if(count == 1){
-      auto& item = data_items[0];
-      
-      assert(item->dimensions.size()>0);
-      
-      size_t length = item->getVolume();
-
-      values_vector.resize(length);
-      
-      std::stringstream stream_data(item->text);
-      
-      for(int i=0; i< length; i++){
-        stream_data >> values_vector[i];
-      }
-      
+      assert(data_items[0]->dimensions.size()>0);
     }
     else{
       assert(false);
@@ -141,6 +162,81 @@ public:
   
   virtual std::string getClassName() const override { return "ListDomain"; };
   
+private:
+  
+  bool compact_on_save = XIDX_COMPACT_LISTS_ON_SAVE;
+  
+  // Exactly the value the HyperSlab domain expands, so that compaction
+  // reads back the same values
+  static bool onProgression(double start, double step, size_t k, double v){
+    return start + k*step == v;
+  }
+  
+  // Split the values into (start, step, count) runs, empty when the
+  // runs would not be smaller than the list
+  static std::vector<double> findRuns(const IndexSpace& values){
+    std::vector<double> runs;
+    size_t n = values.size();
+    
+    for(size_t i=0; i < n;){
+      double step = i+1 < n ? values[i+1]-values[i] : 0;
+      size_t count = i+1 < n ? 2 : 1;
+      while(i+count < n && onProgression(values[i], step, count, values[i+count]))
+        count++;
+      
+      runs.push_back(values[i]);
+      runs.push_back(step);
+      runs.push_back(double(count));
+      
+      if(runs.size()*2 > n)
+        return std::vector<double>();
+      
+      i += count;
+    }
+    
+    return runs;
+  }
+  
+  int writeRuns(ArchiveWriter& writer, const std::vector<double>& runs){
+    std::shared_ptr<DataItem> slab(new DataItem(this));
+    slab->name = data_items[0]->name;
+    slab->number_type = XidxDataType::NumberType::FLOAT_NUMBER_TYPE;
+    slab->bit_precision = 64;
+    if(runs.size() > 3)
+      slab->dimensions.push_back(runs.size()/3);
+    slab->dimensions.push_back(3);
+    
+    std::string text;
+    for(auto r: runs)
+      text += string_format("%.17g ", r);
+    trim(text);
+    slab->setText(text);
+    
+    // written as the HyperSlab domain that reads back the same values
+    DomainType list_type = type;
+    std::vector<std::shared_ptr<DataItem> > list_items(1, slab);
+    list_items.swap(data_items);
+    type = DomainType::HYPER_SLAB_DOMAIN_TYPE;
+    
+    int ret = Domain::write(writer);
+    
+    type = list_type;
+    data_items.swap(list_items);
+    
+    return ret;
+  }
+  
+  // Copy the deserialized values before the list is modified. The list has
+  // as many values as its dimensions, the text may hold more or less.
+  void loadValues(){
+    if(values_vector.empty() && data_items.size() == 1){
+      const IndexSpace& loaded = data_items[0]->getValues();
+      size_t length = data_items[0]->dimensions.size() > 0 ? data_items[0]->getVolume() : loaded.size();
+      values_vector.assign(loaded.begin(), loaded.begin() + std::min(length, loaded.size()));
+      values_vector.resize(length);
+    }
+  }
+  
 };
 
 }
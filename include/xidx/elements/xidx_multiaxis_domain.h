@@ -64,9 +64,19 @@ public:
 //  };
   
   MultiAxisDomain(const MultiAxisDomain* d) : Domain(d->name){
+    type = DomainType::MULTIAXIS_DOMAIN_TYPE;
     setParent(d->getParent());
     axis = d->axis;
     data_items = d->data_items;
+    attributes = d->attributes;
+  }
+  
+  virtual void detach() override{
+    Domain::detach();
+    for(auto& a: axis){
+      a.detach();
+      a.setParent(this);
+    }
   }
   
   int SetAxis(int index, Axis& _axis){
@@ -85,14 +95,14 @@ public:
     return 0;
   }
   
-  virtual xmlNodePtr serialize(xmlNode *parent, const char *text = NULL) override{
-    xmlNodePtr domain_node = xmlNewChild(parent, NULL, BAD_CAST "Domain", NULL);
-    xmlNewProp(domain_node, BAD_CAST "Type", BAD_CAST toString(type));
+  virtual int write(ArchiveWriter& writer) override{
+    writer.beginElement(Element::DOMAIN_ELEMENT);
+    writer.writeAttribute("Type", toString(type));
     data_items.clear();
     
 //    int items_count = 0;
     for(auto& l: axis){
-      l.serialize(domain_node);
+      l.write(writer);
 //      std::shared_ptr<DataItem> itemt(new DataItem(this));
 //      itemt->name = l.name;
 //      data_items.push_back(itemt);
@@ -107,7 +117,7 @@ public:
 //    for(auto item: data_items)
 //      item->serialize(domain_node);
 //    
-    return parent;
+    return writer.endElement();
   }
   
   virtual const Axis& getAxis(int index){
@@ -133,35 +143,30 @@ public:
   
   virtual std::string getClassName() const override { return "MultiAxisDomain"; };
   
-  virtual int deserialize(xmlNodePtr node, Parsable *_parent) override{
-    Domain::deserialize(node, _parent);
+  virtual int read(ArchiveReader& reader, Parsable *_parent) override{
+    Domain::read(reader, _parent);
     setParent(_parent);
     
     assert(getParent()!=nullptr);
     
     int data_items_count=0;
-    for (xmlNode* cur_node = node->children->next; cur_node; cur_node = cur_node->next) {
-      
-      if (cur_node->type == XML_ELEMENT_NODE) {
-        
-        if(isNodeName(cur_node, "Variable")){
+    if(reader.firstChild()){
+      do{
+        if(reader.getElement() == Element::VARIABLE_ELEMENT){
           if(axis.size() > data_items_count){
             Axis& a = axis[data_items_count];
-            a.deserialize(cur_node, this);
+            a.read(reader, this);
           }
           else{
             Axis a(this);
-            a.deserialize(cur_node, this);
+            a.read(reader, this);
             axis.push_back(a);
           }
         
           data_items_count++;
         }
-        else if(isNodeName(cur_node, "Variable")){
-          
-        }
-      }
-      
+      } while(reader.nextSibling());
+      reader.parent();
     }
 
 //    
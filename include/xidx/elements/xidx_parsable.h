@@ -31,8 +31,12 @@
 #define XIDX_PARSABLE_INTERFACE_H_
 
 #include <libxml/encoding.h>
+#include <libxml/valid.h>
 #include <libxml/xmlwriter.h>
 
+#include <mutex>
+#include <set>
+
 #include "xidx/xidx.h"
 
 namespace xidx{
@@ -40,14 +44,163 @@ namespace xidx{
 class Domain;
 class DataSource;
   
-static const char* getProp(xmlNode *node, std::string propName){
-  return reinterpret_cast<const char*>(xmlGetProp(node, BAD_CAST propName.c_str()));
+// Merged values of the attributes of a document made of several nodes,
+// owned by the reader of the document (see DocumentReader), which sets
+// doc->_private to it and frees them with the document
+class MergedValues{
+  
+public:
+  const char* add(const char* value){
+    std::lock_guard<std::mutex> lock(mutex);
+    return values.insert(value != NULL ? value : "").first->c_str();
+  }
+  
+  void clear(){
+    std::lock_guard<std::mutex> lock(mutex);
+    values.clear();
+  }
+  
+private:
+  std::mutex mutex;
+  std::set<std::string> values;
+};
+
+// Value of an attribute made of several nodes (e.g. with entity references).
+// A document with MergedValues may be read by several threads and is never
+// modified, the value is a copy kept with the document. Other documents are
+// read by one thread, the attribute is merged in place into one text node.
+inline const char* getMergedProp(xmlNode *node, xmlAttr* att){
+  xmlChar* value = xmlNodeListGetString(node->doc, att->children, 1);
+  
+  MergedValues* merged = node->doc != NULL ? static_cast<MergedValues*>(node->doc->_private) : NULL;
+  if(merged != NULL){
+    const char* kept = merged->add(reinterpret_cast<const char*>(value));
+    xmlFree(value);
+    return kept;
+  }
+  
+  xmlFreeNodeList(att->children);
+  xmlNode* text = xmlNewDocText(node->doc, value != NULL ? value : BAD_CAST "");
+  text->parent = reinterpret_cast<xmlNode*>(att);
+  att->children = att->last = text;
+  xmlFree(value);
+  return reinterpret_cast<const char*>(text->content);
 }
 
-inline bool isNodeName(xmlNode *node, std::string name){
-  return strcmp(reinterpret_cast<const char*>(node->name), name.c_str())==0;
+// Value of the attribute of node with the given name (or of its default in
+// the DTD), NULL if missing. The string is usually not copied: it belongs
+// to the document and is valid as long as the node, it must not be freed.
+inline const char* getProp(xmlNode *node, const char* propName){
+  for(xmlAttr* att = node->properties; att != NULL; att = att->next){
+    if(strcmp(reinterpret_cast<const char*>(att->name), propName) != 0)
+      continue;
+    
+    xmlNode* text = att->children;
+    if(text == NULL)
+      return "";
+    
+    if(text->next != NULL || text->type != XML_TEXT_NODE)
+      return getMergedProp(node, att);
+    return reinterpret_cast<const char*>(text->content);
+  }
+  
+  if(node->doc != NULL){
+    xmlAttributePtr decl = NULL;
+    if(node->doc->intSubset != NULL)
+      decl = xmlGetDtdAttrDesc(node->doc->intSubset, node->name, BAD_CAST propName);
+    if(decl == NULL && node->doc->extSubset != NULL)
+      decl = xmlGetDtdAttrDesc(node->doc->extSubset, node->name, BAD_CAST propName);
+    if(decl != NULL && decl->defaultValue != NULL)
+      return reinterpret_cast<const char*>(decl->defaultValue);
+  }
+  
+  return NULL;
+}
+
+inline bool isNodeName(xmlNode *node, const char* name){
+  return strcmp(reinterpret_cast<const char*>(node->name), name)==0;
 }
 
+// XML backend of the archive, writing the elements as children of an XML node
+class XmlArchiveWriter : public ArchiveWriter{
+  
+public:
+  XmlArchiveWriter(xmlNode* parent) : node(parent), top(parent){}
+  
+  int beginElement(Element::ElementType element, const char* text = NULL) override{
+    node = xmlNewChild(node, NULL, BAD_CAST Element::toString(element), BAD_CAST text);
+    return 0;
+  }
+  
+  int writeAttribute(const char* name, const char* value) override{
+    xmlNewProp(node, BAD_CAST name, BAD_CAST value);
+    return 0;
+  }
+  
+  int endElement() override{
+    if(node->parent == top)
+      written = node;
+    node = node->parent;
+    return 0;
+  }
+  
+  // Node of the element being written, e.g. to add content specific to XML
+  xmlNode* getNode() const { return node; }
+  
+  // Node of the last element written under the parent
+  xmlNode* getWritten() const { return written; }
+  
+private:
+  xmlNode* node;
+  xmlNode* top;
+  xmlNode* written = NULL;
+};
+
+// XML backend of the archive, reading the elements of a parsed document
+class XmlArchiveReader : public ArchiveReader{
+  
+public:
+  XmlArchiveReader(xmlNode* _node) : node(_node){}
+  
+  Element::ElementType getElement() const override { return elementOf(node); }
+  
+  const char* readAttribute(const char* name) override { return getProp(node, name); }
+  
+  const char* readText() override{
+    if(node->children == NULL)
+      return NULL;
+    return reinterpret_cast<const char*>(node->children->content);
+  }
+  
+  bool firstChild() override { return moveTo(node->children); }
+  
+  bool nextSibling() override { return moveTo(node->next); }
+  
+  void parent() override { node = node->parent; }
+  
+  // Large arrays decoded while the document was read (see DocumentReader)
+  bool takeValues(std::vector<double>& values) override{
+    if(node->_private == NULL)
+      return false;
+    values.swap(*static_cast<std::vector<double>*>(node->_private));
+    return true;
+  }
+  
+  xmlNode* getNode() const { return node; }
+  
+private:
+  xmlNode* node;
+  
+  bool moveTo(xmlNode* first){
+    for(xmlNode* cur_node = first; cur_node; cur_node = cur_node->next)
+      if(cur_node->type == XML_ELEMENT_NODE){
+        node = cur_node;
+        return true;
+      }
+    return false;
+  }
+};
+
 class Parsable{
   
 private:
@@ -58,8 +211,39 @@ public:
   
   int setParent(Parsable *_parent){ parent = _parent; return 0;}
   
-  virtual xmlNode* serialize(xmlNode *parent, const char *text = NULL) = 0;
-  virtual int deserialize(xmlNode *node, Parsable *parent) = 0;
+  // Elements are written and read through an archive, independently of its
+  // encoding. serialize and deserialize use the XML backend, elements that
+  // need more of XML (e.g., includes) override them.
+  virtual int write(ArchiveWriter&){
+    fprintf(stderr, "%s cannot be written to an archive\n", getClassName().c_str());
+    return 1;
+  }
+  
+  virtual int read(ArchiveReader&, Parsable*){
+    fprintf(stderr, "%s cannot be read from an archive\n", getClassName().c_str());
+    return 1;
+  }
+  
+  // NULL if the element could not be written, parent is then left unchanged
+  virtual xmlNode* serialize(xmlNode *parent, const char* = NULL){
+    xmlNode* last = parent->last;
+    XmlArchiveWriter writer(parent);
+    if(write(writer) != 0){
+      for(xmlNode* n = last != NULL ? last->next : parent->children; n != NULL;){
+        xmlNode* next = n->next;
+        xmlUnlinkNode(n);
+        xmlFreeNode(n);
+        n = next;
+      }
+      return NULL;
+    }
+    return writer.getWritten();
+  }
+  
+  virtual int deserialize(xmlNode *node, Parsable *parent){
+    XmlArchiveReader reader(node);
+    return read(reader, parent);
+  }
 
   virtual std::string getDataSourceXPath() { return xpath_prefix; }
   
@@ -81,6 +265,13 @@ public:
   
   virtual Parsable* getParent() const { return parent; };
   
+  // Record a change of the element, groups keep track of the changes made
+  // since they were loaded or saved (see Group::isModified)
+  virtual void markModified(){
+    if(parent != nullptr)
+      parent->markModified();
+  }
+  
 protected:
   std::string xpath_prefix="//";
   
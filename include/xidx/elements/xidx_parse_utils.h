@@ -57,7 +57,7 @@ namespace xidx{
       size_t size = 1 + snprintf(nullptr, 0, format.c_str(), args ...);
       std::unique_ptr<char[]> buf(new char[size]);
       snprintf(buf.get(), size, format.c_str(), args ...);
-      return std::string(buf.get(), buf.get() + size);
+      return std::string(buf.get(), buf.get() + size - 1);
   }
   
   int createNewDoc(xmlDocPtr &doc, xmlNodePtr &root_node)
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2017 University of Utah
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef XIDX_RANGE_DOMAIN_H_
+#define XIDX_RANGE_DOMAIN_H_
+
+#include <cmath>
+
+#include "xidx/xidx.h"
+#include "xidx_parse_utils.h"
+
+namespace xidx{
+
+// Interval [min, max] of physical values, optionally sampled every step.
+// Queries are answered from the bounds, the values are never expanded.
+class RangeDomain : public Domain{
+
+public:
+  RangeDomain(std::string _name) : Domain(_name){
+    type = DomainType::RANGE_DOMAIN_TYPE;
+    
+    std::shared_ptr<DataItem> physical(new DataItem(name, this));
+    physical->format_type = DataItem::FormatType::XML_FORMAT;
+    physical->number_type = XidxDataType::NumberType::FLOAT_NUMBER_TYPE;
+    physical->bit_precision = 64;
+    data_items.push_back(physical);
+  }
+  
+  RangeDomain(const RangeDomain* d) : Domain(d->name){
+    type = DomainType::RANGE_DOMAIN_TYPE;
+    data_items = d->data_items;
+    attributes = d->attributes;
+    min = d->min;
+    max = d->max;
+    step = d->step;
+    bounds = d->bounds;
+  }
+  
+  // A step of 0 describes a continuous range
+  int setRange(double _min, double _max, double _step=0){
+    if(_max < _min || _step < 0){
+      fprintf(stderr, "Invalid range [%g, %g] step %g\n", _min, _max, _step);
+      return 1;
+    }
+    
+    min = _min;
+    max = _max;
+    step = _step;
+    bounds = {min, max};
+    
+    assert(data_items.size() >= 1);
+    std::shared_ptr<DataItem> physical = data_items[0];
+    physical->clearValues();
+    if(isStepped()){
+      physical->dimensions = {3};
+      physical->setText(string_format("%.17g %.17g %.17g", min, max, step));
+    }
+    else{
+      physical->dimensions = {2};
+      physical->setText(string_format("%.17g %.17g", min, max));
+    }
+    
+    markModified();
+    return 0;
+  }
+  
+  double getMin() const { return min; }
+  double getMax() const { return max; }
+  double getStep() const { return step; }
+  
+  bool isStepped() const { return step > 0; }
+  
+  bool contains(double v) const { return v >= min && v <= max; }
+  
+  bool overlaps(double a, double b) const { return a <= max && b >= min; }
+  
+  double clamp(double v) const { return v < min ? min : (v > max ? max : v); }
+  
+  // Whether [a, b] overlaps part i of the range split in n equal parts,
+  // which is how children are mapped to a continuous range
+  bool overlapsPart(double a, double b, size_t i, size_t n) const{
+    if(n <= 1)
+      return overlaps(a, b);
+    
+    double width = (max-min)/n;
+    double part_min = min + i*width;
+    double part_max = i+1 >= n ? max : part_min + width;
+    return a <= part_max && b >= part_min;
+  }
+  
+  // Number of samples of a stepped range, a continuous range has none
+  size_t getNumberOfIndices() const{
+    if(!isStepped())
+      return 0;
+    return size_t(std::floor((max-min)/step + 1e-9)) + 1;
+  }
+  
+  double getValue(size_t i) const { return min + i*step; }
+  
+  // Index of the sample nearest to v, v is clamped to the range first
+  size_t getIndex(double v) const{
+    if(!isStepped())
+      return 0;
+    
+    size_t i = size_t(std::floor((clamp(v)-min)/step + 0.5));
+    size_t n = getNumberOfIndices();
+    return i < n ? i : n-1;
+  }
+  
+  virtual size_t getVolume() const override{
+    return isStepped() ? getNumberOfIndices() : 1;
+  }
+  
+  // The linearized index space of a range is its bounds
+  virtual const IndexSpace& getLinearizedIndexSpace() override{
+    return bounds;
+  };
+  
+  virtual int write(ArchiveWriter& writer) override{
+    assert(data_items.size() >= 1);
+    type = DomainType::RANGE_DOMAIN_TYPE;
+    return Domain::write(writer);
+  };
+  
+  virtual int read(ArchiveReader& reader, Parsable* _parent) override{
+    if(Domain::read(reader, _parent) != 0)
+      return 1;
+    
+    type = DomainType::RANGE_DOMAIN_TYPE;
+    if(data_items.size() < 1 || data_items[0]->getValues().size() < 2){
+      fprintf(stderr, "Range domain %s requires min and max values\n", name.c_str());
+      return 1;
+    }
+    
+    const std::vector<double>& range = data_items[0]->getValues();
+    min = range[0];
+    max = range[1];
+    step = range.size() > 2 ? range[2] : 0;
+    bounds = {min, max};
+    
+    return 0;
+  };
+  
+  virtual std::string getClassName() const override { return "RangeDomain"; };
+  
+  //TODO swig does not allsee these inherited function so rewrite
+  Domain::DomainType getType() { return type; }
+  std::vector<std::shared_ptr<Attribute>> getAttributes() const{ return attributes; }
+  
+private:
+  double min = 0;
+  double max = 0;
+  double step = 0;
+  IndexSpace bounds = IndexSpace(2, 0);
+  
+};
+
+}
+#endif
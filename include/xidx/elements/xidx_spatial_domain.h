@@ -43,7 +43,10 @@ public:
   };
   
   SpatialDomain(const SpatialDomain* dom) : Domain(dom->name){
+    type = DomainType::SPATIAL_DOMAIN_TYPE;
     setParent(dom->getParent());
+    data_items = dom->data_items;
+    attributes = dom->attributes;
     topology = dom->topology;
     geometry = dom->geometry;
   }
@@ -51,12 +54,13 @@ public:
   Topology topology;
   Geometry geometry;
   
-  int setTopology(Topology _topology) { topology = _topology; return 0; }
+  int setTopology(Topology _topology) { topology = _topology; markModified(); return 0; }
   
   int SetTopology(Topology::TopologyType type, uint32_t dims){
     topology.dimensions = toIndexVector(string_format("%d", dims));
     topology.type = type;
     
+    markModified();
     return 0;
   }
   
@@ -66,10 +70,22 @@ public:
     
     topology.type = type;
     
+    markModified();
+    return 0;
+  }
+  
+  // Same with 64-bit extents, for grids with more than 4G samples per axis
+  int setTopology(Topology::TopologyType type, int n_dims, const INDEX_TYPE *dims){
+    for(int i=0; i< n_dims; i++)
+      topology.dimensions.push_back(dims[i]);
+    
+    topology.type = type;
+    
+    markModified();
     return 0;
   }
   
-  int SetGeometry(Geometry _geometry) { geometry = _geometry; return 0; }
+  int SetGeometry(Geometry _geometry) { geometry = _geometry; markModified(); return 0; }
 
   int SetGeometry(Geometry::GeometryType type, int n_dims, const double* ox_oy_oz,
                   const double* dx_dy_dz=NULL) {
@@ -80,12 +96,12 @@ public:
     
     ::XML_FORMAT;
     item_o.number_type = XidxDataType::NumberType::FLOAT_NUMBER_TYPE;
-    item_o.bit_precision = "32";
+    item_o.bit_precision = 32;
     item_o.endian_type = Endianess::EndianType::LITTLE_ENDIANESS;
     DataItem item_d(this);
     item_d.format_type = DataItem::FormatType::XML_FORMAT;
     item_d.number_type = XidxDataType::NumberType::FLOAT_NUMBER_TYPE;
-    item_d.bit_precision = "32";
+    item_d.bit_precision = 32;
     item_d.endian_type = Endianess::EndianType::LITTLE_ENDIANESS;
     
     item_o.dimensions.push_back(n_dims);
@@ -93,51 +109,59 @@ public:
     
     if(type == Geometry::GeometryType::RECT_GEOMETRY_TYPE){
       n_dims *= 2; // two points per dimension
+      std::string text_o;
       for(int i=0; i< n_dims; i++)
-        item_o.text += std::to_string(ox_oy_oz[i])+" ";
-      trim(item_o.text);
+        text_o += std::to_string(ox_oy_oz[i])+" ";
+      trim(text_o);
+      item_o.setText(text_o);
       geometry.items.push_back(item_o);
     }
     else{
+      std::string text_o, text_d;
       for(int i=0; i< n_dims; i++){
-        item_o.text += std::to_string(ox_oy_oz[i])+" ";
-        item_d.text += std::to_string(dx_dy_dz[i])+" ";
+        text_o += std::to_string(ox_oy_oz[i])+" ";
+        text_d += std::to_string(dx_dy_dz[i])+" ";
       }
-      trim(item_o.text);
-      trim(item_d.text);
+      trim(text_o);
+      trim(text_d);
+      item_o.setText(text_o);
+      item_d.setText(text_d);
       geometry.items.push_back(item_o);
       geometry.items.push_back(item_d);
     }
     
+    markModified();
     return 0;
   }
   
-  virtual xmlNodePtr serialize(xmlNode *parent, const char *text = NULL) override{
-    xmlNodePtr domain_node = Domain::serialize(parent, text);
-    xmlNodePtr topology_node = topology.serialize(domain_node);
+  virtual int write(ArchiveWriter& writer) override{
+    beginDomain(writer);
+    topology.write(writer);
     
-    xmlNodePtr geometry_node = geometry.serialize(domain_node);
+    geometry.write(writer);
     
-    return domain_node;
+    return writer.endElement();
   };
   
-  virtual int deserialize(xmlNodePtr node, Parsable *_parent) override{
-    Domain::deserialize(node, _parent);
+  virtual int read(ArchiveReader& reader, Parsable *_parent) override{
+    Domain::read(reader, _parent);
 
     setParent(_parent);
     
-    for (xmlNode* cur_node = node->children->next; cur_node; cur_node = cur_node->next) {
-//      for (xmlNode* inner_node = cur_node->children->next; inner_node; inner_node = inner_node->next) {
-        if (cur_node->type == XML_ELEMENT_NODE) {
-          
-          if(isNodeName(cur_node, "Topology")){
-            topology.deserialize(cur_node, this);
-          }
-          else if(isNodeName(cur_node, "Geometry")){
-            geometry.deserialize(cur_node, this);
-          }
-//        }
-      }
+    if(reader.firstChild()){
+      do{
+        switch(reader.getElement()){
+          case Element::TOPOLOGY_ELEMENT:
+            topology.read(reader, this);
+            break;
+          case Element::GEOMETRY_ELEMENT:
+            geometry.read(reader, this);
+            break;
+          default:
+            break;
+        }
+      } while(reader.nextSibling());
+      reader.parent();
     }
 
     return 0;
@@ -155,12 +179,7 @@ public:
   };
   
   virtual size_t getVolume() const override{
-    size_t total = 1;
-    
-    for(int i=0; i<topology.dimensions.size(); i++)
-      total *= topology.dimensions[i];
-    
-    return total;
+    return volumeOf(topology.dimensions);
   }
 
 
@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2017 University of Utah
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef XIDX_SUBTREE_TABLE_H_
+#define XIDX_SUBTREE_TABLE_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "xidx/xidx.h"
+
+namespace xidx{
+
+// Structural hash of a Domain or Variable element, formatting whitespace,
+// ID and xml:base attributes are not part of the key. Equal keys may still
+// be different subtrees, which users of the key compare.
+class SubtreeKey{
+public:
+  uint64_t h1 = 14695981039346656037ULL;
+  uint64_t h2 = 0x9ae16a3b2f90404fULL;
+  uint64_t length = 0;
+  // data source context of a subtree that depends on it, empty otherwise
+  std::string context;
+  
+  void add(const void* data, size_t size){
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for(size_t i=0; i < size; i++){
+      h1 = (h1 ^ bytes[i]) * 1099511628211ULL;
+      h2 = (h2 ^ bytes[i]) * 0x100000001b3ULL;
+      h2 ^= h2 >> 29;
+    }
+    length += size;
+  }
+  
+  void add(const char* s){ add(s, strlen(s)+1); }
+  
+  bool operator<(const SubtreeKey& k) const{
+    if(h1 != k.h1) return h1 < k.h1;
+    if(h2 != k.h2) return h2 < k.h2;
+    if(length != k.length) return length < k.length;
+    return context < k.context;
+  }
+};
+
+// Keeps one instance of every distinct Domain and Variable subtree met while
+// loading, and the location of the first copy of each subtree while saving
+// so that repeats can be written as XInclude references.
+class SubtreeTable{
+  
+public:
+  
+  static SubtreeKey keyOf(xmlNode* node, const std::string& context){
+    SubtreeKey key;
+    addNode(node, key);
+    
+    // data items that rely on the group data source are only equal in the same context
+    if(isContextDependent(node))
+      key.context = context;
+    
+    return key;
+  }
+  
+  // The subtree loaded first with the key, callers share it only after
+  // comparing it with the subtree they read
+  template<typename T>
+  std::shared_ptr<T> find(const SubtreeKey& key) const{
+    auto it = loaded.find(key);
+    if(it == loaded.end())
+      return nullptr;
+    return std::static_pointer_cast<T>(it->second);
+  }
+  
+  void insert(const SubtreeKey& key, std::shared_ptr<Parsable> obj){
+    loaded[key] = obj;
+  }
+  
+  // Replace a repeated subtree with a reference to its first copy,
+  // the first copy gets an ID attribute. Returns the node in the tree.
+  xmlNodePtr reference(xmlNodePtr node, const char* prefix, const std::string& context){
+    SubtreeKey key = keyOf(node, context);
+    std::string doc_path = getDocPath(node->doc);
+    
+    auto it = saved.find(key);
+    if(it == saved.end()){
+      std::string id = std::string(prefix) + "_" + std::to_string(saved.size());
+      SavedSubtree& first = saved[key];
+      first.copy.reset(xmlCopyNode(node, 1), xmlFreeNode);
+      first.id = id;
+      first.doc_path = doc_path;
+      xmlNewProp(node, BAD_CAST "ID", BAD_CAST id.c_str());
+      return node;
+    }
+    
+    // a different subtree with the same key is written as it is
+    if(!sameNode(node, it->second.copy.get()))
+      return node;
+    
+    xmlNodePtr ref = xmlNewNode(NULL, BAD_CAST "xi:include");
+    if(it->second.doc_path != doc_path)
+      xmlNewProp(ref, BAD_CAST "href", BAD_CAST relativePath(doc_path, it->second.doc_path).c_str());
+    xmlNewProp(ref, BAD_CAST "xpointer", BAD_CAST ("xpointer((//*[@ID='"+it->second.id+"'])[1])").c_str());
+    
+    xmlReplaceNode(node, ref);
+    xmlFreeNode(node);
+    
+    return ref;
+  }
+  
+  size_t getNumberOfSharedSubtrees() const { return loaded.size(); }
+  
+private:
+  // first copy of a saved subtree, its ID and the path of its document
+  struct SavedSubtree{
+    std::shared_ptr<xmlNode> copy;
+    std::string id;
+    std::string doc_path;
+  };
+  
+  std::map<SubtreeKey, std::shared_ptr<Parsable> > loaded;
+  std::map<SubtreeKey, SavedSubtree> saved;
+  
+  static bool isBlank(const xmlChar* s){
+    for(; s != NULL && *s; s++)
+      if(*s != ' ' && *s != '\n' && *s != '\r' && *s != '\t')
+        return false;
+    return true;
+  }
+  
+  static void addNode(xmlNode* node, SubtreeKey& key){
+    key.add((const char*)node->name);
+    
+    for(xmlAttr* att = node->properties; att; att = att->next){
+      if(!isKeyAttribute(att))
+        continue;
+      
+      key.add((const char*)att->name);
+      if(contentOf(att) != NULL)
+        key.add((const char*)contentOf(att));
+    }
+    
+    // values decoded while streaming the document
+    if(node->_private != NULL){
+      const std::vector<double>& values = *static_cast<std::vector<double>*>(node->_private);
+      key.add(values.data(), values.size()*sizeof(double));
+    }
+    
+    for(xmlNode* cur = node->children; cur; cur = cur->next){
+      if(cur->type == XML_ELEMENT_NODE)
+        addNode(cur, key);
+      else if((cur->type == XML_TEXT_NODE || cur->type == XML_CDATA_SECTION_NODE) && !isBlank(cur->content))
+        key.add((const char*)cur->content);
+    }
+    
+    key.add(">");
+  }
+  
+  static bool isKeyAttribute(xmlAttr* att){
+    return !xmlStrEqual(att->name, BAD_CAST "ID") &&
+      (att->ns == NULL || !xmlStrEqual(att->ns->href, XML_XML_NAMESPACE));
+  }
+  
+  static bool isKeyChild(xmlNode* node){
+    return node->type == XML_ELEMENT_NODE ||
+      ((node->type == XML_TEXT_NODE || node->type == XML_CDATA_SECTION_NODE) && !isBlank(node->content));
+  }
+  
+  static const xmlChar* contentOf(xmlAttr* att){
+    return att->children != NULL ? att->children->content : NULL;
+  }
+  
+  // Whether two subtrees are equal for the parts that make their keys
+  static bool sameNode(xmlNode* a, xmlNode* b){
+    if(a->type != b->type)
+      return false;
+    if(a->type != XML_ELEMENT_NODE)
+      return xmlStrEqual(a->content, b->content);
+    if(!xmlStrEqual(a->name, b->name))
+      return false;
+    
+    xmlAttr* x = a->properties;
+    xmlAttr* y = b->properties;
+    for(;; x = x->next, y = y->next){
+      while(x != NULL && !isKeyAttribute(x))
+        x = x->next;
+      while(y != NULL && !isKeyAttribute(y))
+        y = y->next;
+      if(x == NULL || y == NULL)
+        break;
+      if(!xmlStrEqual(x->name, y->name) || !xmlStrEqual(contentOf(x), contentOf(y)))
+        return false;
+    }
+    if(x != NULL || y != NULL)
+      return false;
+    
+    xmlNode* c = a->children;
+    xmlNode* d = b->children;
+    for(;; c = c->next, d = d->next){
+      while(c != NULL && !isKeyChild(c))
+        c = c->next;
+      while(d != NULL && !isKeyChild(d))
+        d = d->next;
+      if(c == NULL || d == NULL)
+        break;
+      if(!sameNode(c, d))
+        return false;
+    }
+    return c == NULL && d == NULL;
+  }
+  
+  static bool isContextDependent(xmlNode* node){
+    if(xmlStrEqual(node->name, BAD_CAST "DataItem")){
+      const char* format = getProp(node, "Format");
+      bool inline_data = format == NULL || strcmp(format, DataItem::toString(DataItem::FormatType::XML_FORMAT)) == 0;
+      
+      if(!inline_data){
+        bool own_source = false;
+        for(xmlNode* cur = node->children; cur; cur = cur->next)
+          if(cur->type == XML_ELEMENT_NODE && xmlStrEqual(cur->name, BAD_CAST "DataSource"))
+            own_source = true;
+        if(!own_source)
+          return true;
+      }
+    }
+    
+    for(xmlNode* cur = node->children; cur; cur = cur->next)
+      if(cur->type == XML_ELEMENT_NODE && isContextDependent(cur))
+        return true;
+    
+    return false;
+  }
+  
+  static std::string getDocPath(xmlDocPtr doc){
+    if(doc == NULL || doc->URL == NULL)
+      return "";
+    return (const char*)doc->URL;
+  }
+  
+  // Path of to_doc as seen from from_doc, both relative to the main file
+  static std::string relativePath(const std::string& from_doc, const std::string& to_doc){
+    std::string path;
+    for(char c : from_doc)
+      if(c == '/')
+        path += "../";
+    return path + to_doc;
+  }
+  
+};
+
+}
+
+#endif
@@ -58,40 +58,43 @@ public:
       default:                            return "[Unknown]";
     }
   }
+  
+  static inline bool fromString(const char* s, TopologyType& v){
+    static const NameTable<TopologyType> table(NO_TOPOLOGY_TYPE, DIM_1D_TOPOLOGY_TYPE, toString);
+    return table.find(s, v);
+  }
 
 public:
 
   std::vector<Attribute> attributes;
   std::vector<DataItem> items;
   TopologyType type;
-  std::vector<INDEX_TYPE> dimensions;
+  IndexVector dimensions;
 
-  xmlNodePtr serialize(xmlNode *parent, const char *text = NULL) override{
+  int write(ArchiveWriter& writer) override{
 
-    xmlNodePtr topology_node = xmlNewChild(parent, NULL, BAD_CAST "Topology", NULL);
+    writer.beginElement(Element::TOPOLOGY_ELEMENT);
 
-    xmlNewProp(topology_node, BAD_CAST "Type", BAD_CAST toString(type));
-    xmlNewProp(topology_node, BAD_CAST "Dimensions", BAD_CAST xidx::toString(dimensions).c_str());
+    writer.writeAttribute("Type", toString(type));
+    writer.writeAttribute("Dimensions", xidx::toString(dimensions).c_str());
     
     for(auto item: items)
-      xmlNodePtr item_node = item.serialize(topology_node);
+      item.write(writer);
 
-    return topology_node;
+    return writer.endElement();
   };
   
-  int deserialize(xmlNodePtr node, Parsable *_parent) override{
-    if(!isNodeName(node,"Topology"))
+  int read(ArchiveReader& reader, Parsable *_parent) override{
+    if(reader.getElement() != Element::TOPOLOGY_ELEMENT)
       return -1;
     
     setParent(_parent);
 
-    const char* topo_type = getProp(node, "Type");
+    const char* topo_type = reader.readAttribute("Type");
 
-    for(int t=TopologyType::NO_TOPOLOGY_TYPE; t <= CORECT_3D_MESH_TOPOLOGY_TYPE; t++)
-      if (strcmp(topo_type, toString(static_cast<TopologyType>(t)))==0)
-          type = static_cast<TopologyType>(t);
+    fromString(topo_type, type);
 
-    dimensions = toIndexVector(xidx::getProp(node, "Dimensions"));
+    dimensions = toIndexVector(reader.readAttribute("Dimensions"));
 
     return 0;
   };
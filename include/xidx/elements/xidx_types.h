@@ -35,6 +35,10 @@
 #include <string>
 #include <sstream>
 #include <algorithm>
+#include <vector>
+#include <initializer_list>
+#include <limits>
+#include <cstdio>
 
 #include "xidx/xidx_config.h"
 
@@ -54,7 +58,7 @@
 namespace xidx{
 class XidxDataType{
 public:
-  enum NumberType{
+  enum NumberType : uint8_t{
     CHAR_NUMBER_TYPE = 0,
     UCHAR_NUMBER_TYPE = 1,
     FLOAT_NUMBER_TYPE = 2,
@@ -75,6 +79,11 @@ public:
     }
   }
   
+  static inline bool fromString(const char* s, NumberType& v){
+    static const NameTable<NumberType> table(CHAR_NUMBER_TYPE, UINT_NUMBER_TYPE, toString);
+    return table.find(s, v);
+  }
+  
 public:
   // TODO add vector types
 
@@ -132,13 +141,184 @@ inline std::string toString(const std::vector<xidx::INDEX_TYPE>& vec){
 }
   
 
+// Dimensions of a data item. Up to XIDX_INLINE_DIMENSIONS extents that fit
+// in 32 bits are stored in the object itself, more dimensions or larger
+// extents switch to a heap array of INDEX_TYPE.
+class IndexVector{
+  
+public:
+  typedef INDEX_TYPE value_type;
+  
+  class const_iterator{
+  public:
+    const_iterator(const IndexVector* _vec, size_t _i) : vec(_vec), i(_i){}
+    INDEX_TYPE operator*() const { return (*vec)[i]; }
+    const_iterator& operator++(){ i++; return *this; }
+    bool operator==(const const_iterator& it) const { return i == it.i; }
+    bool operator!=(const const_iterator& it) const { return i != it.i; }
+  private:
+    const IndexVector* vec;
+    size_t i;
+  };
+  
+  IndexVector(){}
+  IndexVector(const IndexVector& v){ *this = v; }
+  IndexVector(const std::vector<INDEX_TYPE>& v){ *this = v; }
+  IndexVector(std::initializer_list<INDEX_TYPE> l){ *this = l; }
+  
+  ~IndexVector(){
+    if(isWide())
+      delete[] storage.wide;
+  }
+  
+  IndexVector& operator=(const IndexVector& v){
+    if(this == &v)
+      return *this;
+    
+    clear();
+    if(v.isWide())
+      widen(v.count);
+    for(size_t i = 0; i < v.count; i++)
+      push_back(v[i]);
+    return *this;
+  }
+  
+  IndexVector& operator=(const std::vector<INDEX_TYPE>& v){
+    clear();
+    for(auto d: v)
+      push_back(d);
+    return *this;
+  }
+  
+  IndexVector& operator=(std::initializer_list<INDEX_TYPE> l){
+    clear();
+    for(auto d: l)
+      push_back(d);
+    return *this;
+  }
+  
+  size_t size() const { return count; }
+  size_t capacity() const { return isWide() ? max_count : XIDX_INLINE_DIMENSIONS; }
+  bool empty() const { return count == 0; }
+  
+  // Whether the extents are on the heap (see getMemoryUsage of DataItem)
+  bool isWide() const { return max_count > 0; }
+  
+  INDEX_TYPE operator[](size_t i) const { return isWide() ? storage.wide[i] : storage.compact[i]; }
+  
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, count); }
+  
+  void set(size_t i, INDEX_TYPE v){
+    if(!isWide() && !isCompact(v))
+      widen(count);
+    if(isWide())
+      storage.wide[i] = v;
+    else
+      storage.compact[i] = static_cast<uint32_t>(v);
+  }
+  
+  void clear(){ count = 0; }
+  
+  void push_back(INDEX_TYPE v){
+    if(!isWide() && (count == XIDX_INLINE_DIMENSIONS || !isCompact(v)))
+      widen(count + 1);
+    if(isWide() && count == max_count)
+      widen(2 * max_count);
+    
+    count++;
+    set(count - 1, v);
+  }
+  
+  void resize(size_t n, INDEX_TYPE v = 0){
+    if(n > capacity() || !isCompact(v))
+      widen(n);
+    for(size_t i = count; i < n; i++)
+      set(i, v);
+    count = static_cast<uint32_t>(n);
+  }
+  
+  std::vector<INDEX_TYPE> toVector() const{
+    std::vector<INDEX_TYPE> vec(count);
+    for(size_t i = 0; i < count; i++)
+      vec[i] = (*this)[i];
+    return vec;
+  }
+  
+  bool operator==(const IndexVector& v) const {
+    if(count != v.count)
+      return false;
+    for(size_t i = 0; i < count; i++)
+      if((*this)[i] != v[i])
+        return false;
+    return true;
+  }
+  bool operator!=(const IndexVector& v) const { return !(*this == v); }
+  
+private:
+  uint32_t count = 0;
+  uint32_t max_count = 0;   // size of the heap array, 0 when compact
+  union Storage{
+    uint32_t compact[XIDX_INLINE_DIMENSIONS];
+    INDEX_TYPE* wide;
+  } storage;
+  
+  static bool isCompact(INDEX_TYPE v){ return v <= std::numeric_limits<uint32_t>::max(); }
+  
+  // Move the extents to a heap array of at least n values
+  void widen(size_t n){
+    size_t new_count = std::max<size_t>(n, XIDX_INLINE_DIMENSIONS);
+    if(isWide() && new_count <= max_count)
+      return;
+    
+    INDEX_TYPE* wide = new INDEX_TYPE[new_count];
+    for(size_t i = 0; i < count; i++)
+      wide[i] = (*this)[i];
+    if(isWide())
+      delete[] storage.wide;
+    storage.wide = wide;
+    max_count = static_cast<uint32_t>(new_count);
+  }
+};
+
+inline std::string toString(const IndexVector& vec){
+  std::string str="";
+  for(auto v: vec)
+    str+=std::to_string(v)+" ";
+  
+  return trim(str);
+}
+
+// Multiply volume by extent, false (leaving volume as is) if the product
+// does not fit in a size_t
+inline bool multiplyVolume(size_t& volume, uint64_t extent){
+  if(extent != 0 && volume > std::numeric_limits<size_t>::max() / extent)
+    return false;
+  
+  volume *= extent;
+  return true;
+}
+
+// Number of elements of a grid with the given extents, 0 (with an error) if
+// it does not fit in a size_t
+template<typename Dimensions>
+inline size_t volumeOf(const Dimensions& dims){
+  size_t volume = 1;
+  for(size_t i = 0; i < dims.size(); i++)
+    if(!multiplyVolume(volume, dims[i])){
+      fprintf(stderr, "Volume of dimensions %s does not fit in %d bits\n", toString(dims).c_str(), int(8*sizeof(size_t)));
+      return 0;
+    }
+  return volume;
+}
+
 inline std::vector<INDEX_TYPE> toIndexVector(std::string s){
   std::vector<INDEX_TYPE> vec;
   
   std::string delimiter = " ";
   
   if(s.find(delimiter) == std::string::npos){
-    vec.push_back(stoi(s));
+    vec.push_back(std::stoull(s));
     return vec;
   }
   
@@ -146,11 +326,11 @@ inline std::vector<INDEX_TYPE> toIndexVector(std::string s){
   std::string token;
   while ((pos = s.find(delimiter)) != std::string::npos) {
     token = s.substr(0, pos);
-    vec.push_back(stoi(token));
+    vec.push_back(std::stoull(token));
     s.erase(0, pos + delimiter.length());
   }
 
-  vec.push_back(stoi(s));
+  vec.push_back(std::stoull(s));
   
   return vec;
 }
@@ -64,6 +64,11 @@ public:
     }
   }
   
+  static inline bool fromString(const char* s, CenterType& v){
+    static const NameTable<CenterType> table(NODE_CENTER, EDGE_CENTER, toString);
+    return table.find(s, v);
+  }
+  
   class defaults{
   public:
     static const CenterType VARIABLE_CENTER_TYPE = CenterType::CELL_CENTER;
@@ -85,6 +90,20 @@ public:
     setParent(_parent);
   }
   
+  // Copy with its own data items, to be attached to a different group
+  Variable(const Variable* v){
+    setParent(v->getParent());
+    name = v->name;
+    center_type = v->center_type;
+    attributes = v->attributes;
+    
+    for(auto& item: v->data_items){
+      std::shared_ptr<DataItem> copy(new DataItem(*item));
+      copy->setParent(this);
+      data_items.push_back(copy);
+    }
+  }
+  
 //  Variable(const Variable* v){
 //    setParent(v->getParent());
 //    attributes = v->attributes;
@@ -111,20 +130,20 @@ public:
   //   return string_format("%d*%s%d",get_n_components(),numberType.c_str(),n_bytes);
   // }
 
-  virtual xmlNodePtr serialize(xmlNode *parent, const char *text = NULL) override{
-    xmlNodePtr variable_node = xmlNewChild(parent, NULL, BAD_CAST "Variable", NULL);
-    xmlNewProp(variable_node, BAD_CAST "Name", BAD_CAST name.c_str());
+  virtual int write(ArchiveWriter& writer) override{
+    writer.beginElement(Element::VARIABLE_ELEMENT);
+    writer.writeAttribute("Name", name.c_str());
     //if(center_type != defaults::VARIABLE_CENTER_TYPE)
-    xmlNewProp(variable_node, BAD_CAST "Center", BAD_CAST toString(center_type));
+    writer.writeAttribute("Center", toString(center_type));
 
     for(auto item: data_items)
-      xmlNodePtr data_node = item->serialize(variable_node);
+      item->write(writer);
 
     for(auto& curr_att : attributes){
-      xmlNodePtr info_node = curr_att->serialize(variable_node);
+      curr_att->write(writer);
     }
 
-    return variable_node;
+    return writer.endElement();
   };
 
   // int set_raw_data(std::vector<uint32_t>& dims, char* raw_data, char* filepath){
@@ -189,6 +208,7 @@ public:
     for(auto v:vals)
       data_items[0]->addValue(v, stride);
     
+    markModified();
     return 0;
   }
   
@@ -200,6 +220,7 @@ public:
     
     data_items[0]->addValue(v);
     
+    markModified();
     return 0;
   }
   
@@ -216,46 +237,50 @@ public:
   virtual size_t getVolume() const{
     size_t total = 1;
     for(auto& item: this->data_items)
-        total *= item->getVolume();
+      if(!multiplyVolume(total, item->getVolume()))
+        return 0;
     return total;
   }
   
   virtual int addAttribute(std::string name, std::string value){
     std::shared_ptr<Attribute> att(new Attribute(name, value));
     attributes.push_back(att);
+    markModified();
     return 0;
   }
   
-  virtual int deserialize(xmlNodePtr node, Parsable *_parent) override{
-    if(!isNodeName(node,"Variable"))
+  virtual int read(ArchiveReader& reader, Parsable *_parent) override{
+    if(reader.getElement() != Element::VARIABLE_ELEMENT)
       return -1;
 
     setParent(_parent);
     
     assert(getParent()!=nullptr);
     
-    name = xidx::getProp(node, "Name");
+    name = reader.readAttribute("Name");
 
-    const char* center_type_value = getProp(node, "Center");
+    const char* center_type_value = reader.readAttribute("Center");
     if(center_type_value != NULL){
-      for(int t=CenterType::NODE_CENTER; t <= EDGE_CENTER; t++)
-        if (strcmp(center_type_value, toString(static_cast<CenterType>(t)))==0)
-            center_type = static_cast<CenterType>(t);
+      fromString(center_type_value, center_type);
     }
     else
       center_type = defaults::VARIABLE_CENTER_TYPE;
 
-    for (xmlNode* inner_node = node->children->next; inner_node; inner_node = inner_node->next) {
-      if(isNodeName(inner_node, "Attribute")){
-        std::shared_ptr<Attribute> att(new Attribute);
-        att->deserialize(inner_node, this);
-        attributes.push_back(att);
-      }
-      if(isNodeName(inner_node, "DataItem")){
-        std::shared_ptr<DataItem> ditem(new DataItem(this));
-        ditem->deserialize(inner_node, ditem->getParent());
-        data_items.push_back(ditem);
-      }
+    if(reader.firstChild()){
+      do{
+        Element::ElementType element = reader.getElement();
+        if(element == Element::ATTRIBUTE_ELEMENT){
+          std::shared_ptr<Attribute> att(new Attribute);
+          att->read(reader, this);
+          attributes.push_back(att);
+        }
+        if(element == Element::DATA_ITEM_ELEMENT){
+          std::shared_ptr<DataItem> ditem(new DataItem(this));
+          ditem->read(reader, ditem->getParent());
+          data_items.push_back(ditem);
+        }
+      } while(reader.nextSibling());
+      reader.parent();
     }
 
     return 0;
@@ -263,22 +288,46 @@ public:
   
   virtual std::vector<std::shared_ptr<Attribute>> getAttributes() const { return attributes; }
   
-  virtual int addAttribute(const std::shared_ptr<Attribute>& att){ attributes.push_back(att); return 0; }
+  virtual int addAttribute(const std::shared_ptr<Attribute>& att){
+    if(att->getParent() == nullptr)
+      att->setParent(this);
+    attributes.push_back(att);
+    markModified();
+    return 0;
+  }
   
   virtual int addAttribute(const std::vector<std::shared_ptr<Attribute>>& atts){
     attributes.insert(attributes.end(), atts.begin(), atts.end());
+    markModified();
     return 0;
   }
   
   virtual std::vector<std::shared_ptr<DataItem> > getDataItems() const { return data_items; }
   
-  virtual int addDataItem(const std::shared_ptr<DataItem>& di){ data_items.push_back(di); return 0; }
+  virtual int addDataItem(const std::shared_ptr<DataItem>& di){ data_items.push_back(di); markModified(); return 0; }
   
   virtual int addDataItem(const std::vector<std::shared_ptr<DataItem> >& dis){
     data_items.insert(data_items.end(), dis.begin(), dis.end());
+    markModified();
     return 0;
   }
   
+  // Give a copy of a variable its own data items and attributes, so that it
+  // does not change with the variable it was copied from
+  void detach(){
+    for(auto& item: data_items){
+      item = std::make_shared<DataItem>(*item);
+      item->setParent(this);
+      if(item->data_source != nullptr)
+        item->data_source = std::make_shared<DataSource>(item->data_source.get());
+    }
+    
+    for(auto& att: attributes){
+      att = std::make_shared<Attribute>(att.get());
+      att->setParent(this);
+    }
+  }
+  
   virtual std::string getClassName() const override { return "Variable"; };
 
 };
@@ -39,21 +39,28 @@
 #include <set>
 
 namespace xidx{
-  typedef uint32_t INDEX_TYPE;
+  typedef uint64_t INDEX_TYPE;
   typedef double PHY_TYPE;
 }
 
 #include "xidx_config.h"
+#include "xidx_thread_pool.h"
+#include "xidx_library.h"
+#include "xidx_name_table.h"
+#include "xidx_archive.h"
+#include "xidx_buffer_archive.h"
 #include "elements/xidx_parsable.h"
 #include "xidx_data_source.h"
 #include "elements/xidx_attribute.h"
 #include "elements/xidx_types.h"
+#include "elements/xidx_encoding.h"
 #include "elements/xidx_dataitem.h"
 
 #include "xidx_index_space.h"
 #include "elements/xidx_domain.h"
 #include "elements/xidx_list_domain.h"
 #include "elements/xidx_hyperslab_domain.h"
+#include "elements/xidx_range_domain.h"
 #include "elements/xidx_topology.h"
 #include "elements/xidx_geometry.h"
 #include "elements/xidx_spatial_domain.h"
@@ -63,6 +70,7 @@ namespace xidx{
 namespace xidx {
 typedef HyperSlabDomain TemporalHyperSlabDomain;
 typedef ListDomain<PHY_TYPE> TemporalListDomain;
+typedef RangeDomain TemporalRangeDomain;
   
 //template<typename T>
 //using Axis = ListDomain<T>;
@@ -78,8 +86,11 @@ typedef Variable Axis;
 }
 
 #include "elements/xidx_multiaxis_domain.h"
+#include "elements/xidx_subtree_table.h"
+#include "elements/xidx_group_table.h"
 #include "elements/xidx_group.h"
 
+#include "xidx_journal.h"
 #include "xidx_file.h"
 
 
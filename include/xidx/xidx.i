@@ -148,10 +148,15 @@ using namespace xidx;
 %shared_ptr(xidx::Attribute)
 %shared_ptr(xidx::DataItem)
 %shared_ptr(xidx::Variable)
+%shared_ptr(xidx::GroupPrefetcher)
+%shared_ptr(xidx::GroupCache)
+%shared_ptr(xidx::Journal)
 %shared_ptr(xidx::ListDomain<double>)
 //%shared_ptr(ListDomainDouble)
 
 %include <xidx.h>
+%include <xidx_library.h>
+%include <xidx_journal.h>
 %include <xidx_file.h>
 %include <xidx_data_source.h>
 %include <xidx_index_space.h>
@@ -159,12 +164,15 @@ using namespace xidx;
 %include <elements/xidx_dataitem.h>
 %include <elements/xidx_domain.h>
 %include <elements/xidx_types.h>
+%include <elements/xidx_encoding.h>
 %include <elements/xidx_geometry.h>
 %include <elements/xidx_topology.h>
 %include <elements/xidx_spatial_domain.h>
 %include <elements/xidx_list_domain.h>
 %include <elements/xidx_hyperslab_domain.h>
+%include <elements/xidx_range_domain.h>
 %include <elements/xidx_multiaxis_domain.h>
+%include <elements/xidx_group_table.h>
 
 %include <elements/xidx_group.h>
 %include <elements/xidx_variable.h>
@@ -179,6 +187,8 @@ using namespace xidx;
 %template(GroupVector) std::vector<std::shared_ptr<xidx::Group>>;
 
 %include "xidx.h"
+%include "xidx_library.h"
+%include "xidx_journal.h"
 %include "xidx_file.h"
 %include "xidx_data_source.h"
 %include "xidx_index_space.h"
@@ -187,9 +197,12 @@ using namespace xidx;
 %include "elements/xidx_domain.h"
 %include "elements/xidx_spatial_domain.h"
 %include "elements/xidx_hyperslab_domain.h"
+%include "elements/xidx_range_domain.h"
 %include "elements/xidx_list_domain.h"
 %include "elements/xidx_multiaxis_domain.h"
+%include "elements/xidx_group_table.h"
 %include "elements/xidx_types.h"
+%include "elements/xidx_encoding.h"
 %include "elements/xidx_geometry.h"
 %include "elements/xidx_topology.h"
 %include "elements/xidx_group.h"
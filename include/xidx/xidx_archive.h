@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2017 University of Utah
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef XIDX_ARCHIVE_H_
+#define XIDX_ARCHIVE_H_
+
+#include <vector>
+
+#include "xidx_name_table.h"
+
+namespace xidx{
+
+// Writer of the elements of a metadata tree in the encoding of a backend
+// (e.g., XML). An element is opened by beginElement, followed by its
+// attributes and its child elements, and closed by endElement.
+class ArchiveWriter{
+  
+public:
+  virtual ~ArchiveWriter(){}
+  
+  // Open an element as the last child of the current one, with optional text
+  virtual int beginElement(Element::ElementType element, const char* text = NULL) = 0;
+  
+  // Attribute of the element opened last
+  virtual int writeAttribute(const char* name, const char* value) = 0;
+  
+  // Close the current element, its parent becomes current
+  virtual int endElement() = 0;
+};
+
+// Reader of the elements of a metadata tree, positioned on one element at a
+// time. The children of an element are visited with firstChild, nextSibling
+// and back to the element with parent, so that reading a child leaves the
+// reader where it was.
+class ArchiveReader{
+  
+public:
+  virtual ~ArchiveReader(){}
+  
+  // Element the reader is positioned on
+  virtual Element::ElementType getElement() const = 0;
+  
+  // Value of an attribute of the current element, NULL if missing. The
+  // string belongs to the reader and is valid until it moves.
+  virtual const char* readAttribute(const char* name) = 0;
+  
+  // Text of the current element, NULL if none
+  virtual const char* readText() = 0;
+  
+  // Move to the first child element, false (without moving) if there is none
+  virtual bool firstChild() = 0;
+  
+  // Move to the next sibling element, false (without moving) at the last one
+  virtual bool nextSibling() = 0;
+  
+  // Move back to the parent of the current element
+  virtual void parent() = 0;
+  
+  // Values of the current element already decoded by the backend (e.g.,
+  // while the document was read), false if there are none
+  virtual bool takeValues(std::vector<double>&){ return false; }
+};
+
+}
+#endif
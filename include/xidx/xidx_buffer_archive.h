@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2017 University of Utah
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef XIDX_BUFFER_ARCHIVE_H_
+#define XIDX_BUFFER_ARCHIVE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "xidx_archive.h"
+
+namespace xidx{
+
+// Binary backend of the archive, a contiguous buffer that can be sent to
+// other processes (see MetadataFile::serializeToBuffer).
+//
+// The buffer starts with a magic string followed by one token per call of
+// the writer: an element type opens an element and is followed by its
+// text, ATTRIBUTE_TOKEN is followed by the name and the value of an
+// attribute, END_TOKEN closes the element. A name is written once, and then
+// as its index in the order of appearance. Lengths are varints, strings are
+// followed by a 0 so that the reader returns them from the buffer.
+class BufferArchive{
+
+public:
+  enum Token{
+    END_TOKEN = 0,
+    ATTRIBUTE_TOKEN = 0x7f
+  };
+  
+  static const char* magic(){ return "XIDXBUF1"; }
+  static const size_t magic_size = 8;
+};
+
+class BufferArchiveWriter : public ArchiveWriter{
+  
+public:
+  BufferArchiveWriter(){ buffer.append(BufferArchive::magic(), BufferArchive::magic_size); }
+  
+  int beginElement(Element::ElementType element, const char* text = NULL) override{
+    buffer.push_back((char)element);
+    if(text == NULL)
+      putVarint(0);
+    else
+      putString(text, strlen(text), 1);
+    
+    depth++;
+    return 0;
+  }
+  
+  int writeAttribute(const char* name, const char* value) override{
+    buffer.push_back((char)BufferArchive::ATTRIBUTE_TOKEN);
+    
+    size_t index = 0;
+    while(index < names.size() && names[index] != name)
+      index++;
+    
+    putVarint(index);
+    if(index == names.size()){
+      names.push_back(name);
+      putString(name, names.back().size(), 0);
+    }
+    
+    if(value == NULL)
+      value = "";
+    putString(value, strlen(value), 0);
+    return 0;
+  }
+  
+  int endElement() override{
+    if(depth == 0){
+      fprintf(stderr, "endElement without an element to close\n");
+      return 1;
+    }
+    
+    buffer.push_back((char)BufferArchive::END_TOKEN);
+    depth--;
+    return 0;
+  }
+  
+  // Bytes written so far, complete when all the elements are closed
+  const std::string& getBuffer() const { return buffer; }
+  
+  // Move the bytes to out, the writer starts a new buffer
+  int swap(std::string& out){
+    if(depth != 0)
+      fprintf(stderr, "Warning: %d elements are not closed in the buffer\n", depth);
+    
+    out.swap(buffer);
+    buffer.assign(BufferArchive::magic(), BufferArchive::magic_size);
+    names.clear();
+    depth = 0;
+    return 0;
+  }
+  
+private:
+  std::string buffer;
+  std::vector<std::string> names;
+  int depth = 0;
+  
+  void putVarint(uint64_t v){
+    while(v >= 0x80){
+      buffer.push_back((char)((v & 0x7f) | 0x80));
+      v >>= 7;
+    }
+    buffer.push_back((char)v);
+  }
+  
+  // The length is shifted by offset, so that 0 can mean a missing string
+  void putString(const char* s, size_t size, uint64_t offset){
+    putVarint(size + offset);
+    buffer.append(s, size);
+    buffer.push_back('\0');
+  }
+};
+
+// Reader of a buffer written by BufferArchiveWriter. The buffer is indexed
+// by one pass in parse, and must outlive the reader since the strings
+// returned point into it.
+class BufferArchiveReader : public ArchiveReader{
+  
+public:
+  
+  // Index the elements of the buffer and move to the first one
+  int parse(const char* data, size_t size){
+    nodes.clear();
+    attributes.clear();
+    names.clear();
+    current = NONE;
+    
+    if(size < BufferArchive::magic_size || memcmp(data, BufferArchive::magic(), BufferArchive::magic_size) != 0){
+      fprintf(stderr, "The buffer is not an xidx archive\n");
+      return 1;
+    }
+    
+    const char* end = data + size;
+    const char* p = data + BufferArchive::magic_size;
+    
+    // last child of each open element, to link the next one
+    std::vector<uint32_t> open;
+    std::vector<uint32_t> last_child;
+    
+    while(p < end){
+      unsigned char token = (unsigned char)*p++;
+      
+      if(token == BufferArchive::END_TOKEN){
+        if(open.empty())
+          return corrupted(p, data);
+        open.pop_back();
+        last_child.pop_back();
+      }
+      else if(token == BufferArchive::ATTRIBUTE_TOKEN){
+        uint64_t index = 0;
+        const char* value = NULL;
+        if(open.empty() || !getVarint(p, end, index) || index > names.size())
+          return corrupted(p, data);
+        
+        if(index == names.size()){
+          const char* name = NULL;
+          if(!getString(p, end, 0, name))
+            return corrupted(p, data);
+          names.push_back(name);
+        }
+        
+        // the attributes of an element come before its children
+        Node& node = nodes[open.back()];
+        if(node.end_attribute != attributes.size() || !getString(p, end, 0, value))
+          return corrupted(p, data);
+        
+        attributes.push_back(Attribute{names[index], value});
+        node.end_attribute++;
+      }
+      else if(token >= Element::XIDX_ELEMENT && token <= Element::INCLUDE_ELEMENT){
+        Node node;
+        node.element = (Element::ElementType)token;
+        node.first_attribute = node.end_attribute = (uint32_t)attributes.size();
+        node.parent = open.empty() ? NONE : open.back();
+        if(!getString(p, end, 1, node.text))
+          return corrupted(p, data);
+        
+        uint32_t index = (uint32_t)nodes.size();
+        if(open.empty()){
+          if(index != 0)
+            return corrupted(p, data);
+        }
+        else if(last_child.back() == NONE)
+          nodes[open.back()].first_child = index;
+        else
+          nodes[last_child.back()].next_sibling = index;
+        
+        if(!last_child.empty())
+          last_child.back() = index;
+        
+        nodes.push_back(node);
+        open.push_back(index);
+        last_child.push_back(NONE);
+      }
+      else
+        return corrupted(p, data);
+    }
+    
+    if(!open.empty() || nodes.empty())
+      return corrupted(p, data);
+    
+    current = 0;
+    return 0;
+  }
+  
+  Element::ElementType getElement() const override{
+    return current == NONE ? Element::UNKNOWN_ELEMENT : nodes[current].element;
+  }
+  
+  const char* readAttribute(const char* name) override{
+    const Node& node = nodes[current];
+    for(uint32_t i = node.first_attribute; i < node.end_attribute; i++)
+      if(strcmp(attributes[i].name, name) == 0)
+        return attributes[i].value;
+    return NULL;
+  }
+  
+  const char* readText() override { return nodes[current].text; }
+  
+  bool firstChild() override { return moveTo(nodes[current].first_child); }
+  
+  bool nextSibling() override { return moveTo(nodes[current].next_sibling); }
+  
+  void parent() override { current = nodes[current].parent; }
+  
+private:
+  enum : uint32_t { NONE = 0xffffffff };
+  
+  struct Node{
+    Element::ElementType element;
+    const char* text = NULL;
+    uint32_t first_attribute = 0;
+    uint32_t end_attribute = 0;
+    uint32_t parent = NONE;
+    uint32_t first_child = NONE;
+    uint32_t next_sibling = NONE;
+  };
+  
+  struct Attribute{
+    const char* name;
+    const char* value;
+  };
+  
+  std::vector<Node> nodes;
+  std::vector<Attribute> attributes;
+  std::vector<const char*> names;
+  uint32_t current = NONE;
+  
+  bool moveTo(uint32_t index){
+    if(index == NONE)
+      return false;
+    current = index;
+    return true;
+  }
+  
+  static bool getVarint(const char*& p, const char* end, uint64_t& v){
+    v = 0;
+    for(int shift=0; shift < 64 && p < end; shift += 7){
+      unsigned char c = (unsigned char)*p++;
+      v |= (uint64_t)(c & 0x7f) << shift;
+      if((c & 0x80) == 0)
+        return true;
+    }
+    return false;
+  }
+  
+  // A length of 0 with offset 1 is a missing string
+  static bool getString(const char*& p, const char* end, uint64_t offset, const char*& s){
+    uint64_t size = 0;
+    if(!getVarint(p, end, size))
+      return false;
+    
+    if(offset == 1 && size == 0){
+      s = NULL;
+      return true;
+    }
+    
+    if(size < offset)
+      return false;
+    
+    size -= offset;
+    if(size >= (uint64_t)(end - p) || p[size] != '\0')
+      return false;
+    
+    s = p;
+    p += size + 1;
+    return true;
+  }
+  
+  int corrupted(const char* p, const char* data){
+    fprintf(stderr, "The xidx archive is corrupted at byte %zu\n", size_t(p - data));
+    nodes.clear();
+    current = NONE;
+    return 1;
+  }
+};
+
+}
+#endif
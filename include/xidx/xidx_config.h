@@ -7,4 +7,56 @@
 
 #define XIDX_DEBUG_XPATHS 0
 
+// Inline arrays longer than this (in characters) are decoded while the
+// document is parsed instead of being stored as a text node
+#ifndef XIDX_STREAM_DECODE_THRESHOLD
+#define XIDX_STREAM_DECODE_THRESHOLD (1 << 20)
+#endif
+
+// Threads used by the library, 0 means one per hardware thread
+#ifndef XIDX_MAX_THREADS
+#define XIDX_MAX_THREADS 0
+#endif
+
+// Inline text arrays longer than this (in characters) are parsed in
+// parallel, in blocks of XIDX_PARALLEL_DECODE_BLOCK characters
+#ifndef XIDX_PARALLEL_DECODE_THRESHOLD
+#define XIDX_PARALLEL_DECODE_THRESHOLD (4 << 20)
+#endif
+
+#ifndef XIDX_PARALLEL_DECODE_BLOCK
+#define XIDX_PARALLEL_DECODE_BLOCK (1 << 20)
+#endif
+
+// Bytes of the data source read ahead with a prefetched group
+// (see Group::setPrefetch)
+#ifndef XIDX_PREFETCH_HEADER_BYTES
+#define XIDX_PREFETCH_HEADER_BYTES 4096
+#endif
+
+// Default of MetadataFile::setIncrementalSave
+#ifndef XIDX_INCREMENTAL_SAVE
+#define XIDX_INCREMENTAL_SAVE 0
+#endif
+
+// Default of Library::setMemoryDump, 1 dumps the libxml memory after each save
+#ifndef XIDX_MEMORY_DUMP
+#define XIDX_MEMORY_DUMP 0
+#endif
+
+// Default of Journal::setSync, 1 syncs each record appended to the journal
+#ifndef XIDX_JOURNAL_SYNC
+#define XIDX_JOURNAL_SYNC 1
+#endif
+
+// Number of dimensions of a data item stored without a heap allocation
+#ifndef XIDX_INLINE_DIMENSIONS
+#define XIDX_INLINE_DIMENSIONS 4
+#endif
+
+// Default of ListDomain::setCompactOnSave
+#ifndef XIDX_COMPACT_LISTS_ON_SAVE
+#define XIDX_COMPACT_LISTS_ON_SAVE 0
+#endif
+
 #endif
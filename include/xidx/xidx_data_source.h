@@ -40,6 +40,10 @@ class DataSource : public Parsable{
 private:
   std::string url;
   bool inline_metadata;
+  
+  // first bytes of the payload, see readHeader
+  std::string header;
+  bool header_read = false;
 
 public:
 
@@ -53,6 +57,8 @@ public:
     url = ds->url;
     name = ds->name;
     inline_metadata = ds->inline_metadata;
+    header = ds->header;
+    header_read = ds->header_read;
   }
   
   DataSource(std::string _name, std::string path, bool do_inline_metadata=false){
@@ -63,14 +69,40 @@ public:
   
   std::string getUrl(){ return url; }
   
-  int setFilePath(std::string path){ url = path; return 0; }
+  int setFilePath(std::string path){ url = path; header_read = false; header.clear(); return 0; }
+  
+  // First bytes of a local payload (e.g., the IDX header), read once and
+  // kept with the data source. Empty for remote or missing files.
+  const std::string& readHeader(size_t n_bytes=XIDX_PREFETCH_HEADER_BYTES){
+    if(header_read)
+      return header;
+    
+    header_read = true;
+    if(url.find("://") != std::string::npos)
+      return header;
+    
+    std::ifstream ifs(url.c_str(), std::ios::binary);
+    if(ifs){
+      header.resize(n_bytes);
+      ifs.read(&header[0], n_bytes);
+      header.resize(size_t(ifs.gcount()));
+    }
+    
+    return header;
+  }
   
-  xmlNodePtr serialize(xmlNode *parent_node, const char *text = NULL) override{
-    xmlNodePtr ds_node = xmlNewChild(parent_node, NULL, BAD_CAST "DataSource", NULL);
-    xmlNewProp(ds_node, BAD_CAST "Name", BAD_CAST name.c_str());
-    xmlNewProp(ds_node, BAD_CAST "Url", BAD_CAST url.c_str());
+  int write(ArchiveWriter& writer) override{
+    writer.beginElement(Element::DATA_SOURCE_ELEMENT);
+    writer.writeAttribute("Name", name.c_str());
+    writer.writeAttribute("Url", url.c_str());
     
-    if(inline_metadata){
+    // the metadata of the source can be copied inline only in XML
+    XmlArchiveWriter* xml_writer = dynamic_cast<XmlArchiveWriter*>(&writer);
+    if(inline_metadata && xml_writer == nullptr)
+      fprintf(stderr, "inline metadata of data source %s is only written to XML\n", name.c_str());
+    else if(inline_metadata){
+      xmlNodePtr ds_node = xml_writer->getNode();
+      
       if (url.find("://") != std::string::npos)
         fprintf(stderr, "url data source inline not supported\n");
       
@@ -96,17 +128,17 @@ public:
       }
     }
     
-    return ds_node;
+    return writer.endElement();
   }
   
-  virtual int deserialize(xmlNodePtr node, Parsable *_parent) override{
+  virtual int read(ArchiveReader& reader, Parsable *_parent) override{
     setParent(_parent);
     
-    if(!xidx::isNodeName(node,"DataSource"))
+    if(reader.getElement() != Element::DATA_SOURCE_ELEMENT)
       return -1;
     
-    name = xidx::getProp(node, "Name");
-    url = xidx::getProp(node, "Url");
+    name = reader.readAttribute("Name");
+    url = reader.readAttribute("Url");
     
     return 0;
   }
@@ -31,6 +31,7 @@
 #define XIDX_FILE_H_
 
 #include "xidx.h"
+#include "xidx_reader.h"
 #include <libxml/xinclude.h>
 
 namespace xidx{
@@ -45,23 +46,79 @@ private:
 
   bool loaded;
 
+  // Share identical domains and variables when loading,
+  // write repeated ones as references when saving
+  bool share_on_load = false;
+  bool reference_on_save = false;
+  
+  // Deserialize sibling groups on the thread pool
+  bool parallel_load = false;
+  
+  // Serialize and write the child groups on the thread pool
+  bool parallel_save = false;
+  
+  // Children of the root group read on demand after a selective load
+  std::shared_ptr<GroupCache> cache;
+  
+  // Rewrite only what changed since the last load or save
+  bool incremental_save = XIDX_INCREMENTAL_SAVE;
+  
+  // Changes appended since the last save, replayed by Load
+  std::shared_ptr<Journal> journal;
+  
+  // Last journal record replayed by Load (0 for all of them)
+  uint64_t replay_up_to = 0;
+  
+  // Saves requested by saveAsync, written in order by save_thread
+  struct SaveRequest;
+  std::unique_ptr<SaveRequest> pending_save;
+  std::mutex save_mutex;
+  std::condition_variable save_ready;
+  std::thread save_thread;
+  bool stopping = false;
+
 public:
 
     MetadataFile(std::string path) : file_path(path){ };
+  
+  // Pending saves are written first
+  ~MetadataFile(){
+    {
+      std::lock_guard<std::mutex> lock(save_mutex);
+      stopping = true;
+    }
+    save_ready.notify_one();
+    if(save_thread.joinable())
+      save_thread.join();
+  }
 
   int Load(){
-    LIBXML_TEST_VERSION;
-    
-    xmlDocPtr doc; /* the resulting document tree */
+    return Load(DomainSelection());
+  }
+
+  // Load only the children of the root group with index in [first, last]
+  int Load(DomainIndex first, DomainIndex last){
+    return Load(DomainSelection::indexRange(first, last));
+  }
+
+  // Load only the children of the root group with domain value in [t_start, t_end]
+  int LoadTimeRange(PHY_TYPE t_start, PHY_TYPE t_end){
+    return Load(DomainSelection::timeRange(t_start, t_end));
+  }
+
+  int Load(const DomainSelection& selection){
+    Library::init();
     
-    doc = xmlReadFile(file_path.c_str(), NULL, XML_PARSE_XINCLUDE );
+    DocumentReader reader;
+    xmlDocPtr doc = reader.read(file_path, XML_PARSE_XINCLUDE | XML_PARSE_HUGE);
     if (doc == NULL) {
       fprintf(stderr, "Failed to parse %s\n", file_path.c_str());
       return 1;
     }
     
+    // with a selection the includes are processed only for the selected groups
     bool includes = false;
-    if (xmlXIncludeProcess(doc) <= 0) {
+    if (selection.isAll() && xmlXIncludeProcessFlags(doc, XML_PARSE_XINCLUDE | XML_PARSE_HUGE) <= 0) {
       fprintf(stderr, "XInclude processing failed. Are there any XInclude?\n");
       includes = true;
     }
@@ -71,45 +128,60 @@ public:
     if(!root_element || !(root_element->children) || !(root_element->children->next))
       return 1;
     
+    // journal records already folded into the file
+    uint64_t folded = 0;
+    const char* sequence = getProp(root_element, "JournalSequence");
+    if(sequence != NULL)
+      folded = strtoull(sequence, NULL, 10);
+    
     for (xmlNode* cur_node = root_element->children->next; cur_node; cur_node = cur_node->next) {
-      if(isNodeName(cur_node,"Group")){
+      if(elementOf(cur_node) == Element::GROUP_ELEMENT){
+        // the children cached for the previous root are released
+        if(root_group != nullptr)
+          root_group->setCache(nullptr);
+        
+        SubtreeTable subtrees;
         root_group = std::make_shared<Group>(new Group("root"));
+        root_group->setSelection(selection);
+        root_group->setSubtreeTable(share_on_load ? &subtrees : nullptr);
+        root_group->setParallelDeserialize(parallel_load && selection.isAll());
         root_group->deserialize(cur_node, nullptr);//(Parsable*)(root_group->get()));
+        root_group->setSubtreeTable(nullptr);
+        root_group->setParallelDeserialize(false);
+        root_group->setCache(cache);
       }
     }
     
-    xmlFreeDoc(doc);
+    getJournal()->setFolded(folded);
+    if(root_group != nullptr && journal->exists()){
+      if(selection.isAll())
+        replayJournal(folded);
+      else
+        fprintf(stderr, "Warning: the journal of %s is not replayed by a selective load\n", file_path.c_str());
+    }
     
     return 0;
 
   }
   
   int save(){
+    // the journal is folded into the file
+    SaveRequest r = request();
+    int ret = writeDocument(r);
     
-    xmlDocPtr doc = NULL;       /* document pointer */
-    xmlNodePtr root_node = NULL;/* node pointers */
-    
-    LIBXML_TEST_VERSION;
-    
-    createNewDoc(doc, root_node);
-
-    if(root_group != nullptr)
-      root_group->serialize(root_node);
-    
-    saveDoc(file_path, doc);
+    if(ret >= 0 && root_group != nullptr)
+      root_group->clearModified();
     
-    /*
-     *Free the global variables that may
-     *have been allocated by the parser.
-     */
-    xmlCleanupParser();
+    if(ret >= 0 && r.folded > 0)
+      r.journal->truncate(r.folded);
     
     /*
      * this is to debug memory for regression tests
      */
-    xmlMemoryDump();
+    if(Library::getMemoryDump())
+      xmlMemoryDump();
     
-    return 0; 
+    return ret < 0 ? 1 : 0;
   }
   
   int save(std::string path){
@@ -117,12 +189,250 @@ public:
     return save();
   };
 
+  // Write the loaded tree to a contiguous buffer (see BufferArchive), e.g. to
+  // send it to other processes that rebuild it with loadFromBuffer instead of
+  // reading the file. Includes are written inline, the children left out by
+  // a selective load are not written and shared subtrees are written as
+  // copies (see Group::write for what the buffer does not keep).
+  int serializeToBuffer(std::string& buffer){
+    BufferArchiveWriter writer;
+    writer.beginElement(Element::XIDX_ELEMENT);
+    writer.writeAttribute("Version", "2.0");
+
+    if(root_group != nullptr && root_group->write(writer) != 0)
+      return 1;
+
+    writer.endElement();
+    return writer.swap(buffer);
+  }
+
+  // Rebuild the tree from a buffer written by serializeToBuffer, in one pass
+  // over the buffer without parsing XML. The journal is not replayed.
+  int loadFromBuffer(const char* data, size_t size){
+    BufferArchiveReader reader;
+    if(reader.parse(data, size) != 0)
+      return 1;
+
+    if(reader.getElement() != Element::XIDX_ELEMENT || !reader.firstChild()){
+      fprintf(stderr, "No group in the buffer of %s\n", file_path.c_str());
+      return 1;
+    }
+
+    do{
+      if(reader.getElement() == Element::GROUP_ELEMENT){
+        if(root_group != nullptr)
+          root_group->setCache(nullptr);
+
+        root_group = std::make_shared<Group>("root");
+        if(root_group->read(reader, nullptr) != 0)
+          return 1;
+        root_group->setCache(cache);
+      }
+    } while(reader.nextSibling());
+
+    return 0;
+  }
+
+  int loadFromBuffer(const std::string& buffer){
+    return loadFromBuffer(buffer.data(), buffer.size());
+  }
+  
+  // Save on a background thread, the result is available from the future.
+  // The groups are copied first (see Group::snapshot), so that the tree can
+  // be changed as soon as it returns. A save requested while another is
+  // being written waits for it, and is replaced by the following requests
+  // (their futures share the result of the last one). Incremental saves and
+  // references are not used, do not mix with save() on the same file.
+  std::future<int> saveAsync(){
+    SaveRequest r = request();
+    r.root = root_group != nullptr ? root_group->snapshot() : nullptr;
+    r.incremental = false;
+    r.parallel = parallel_save;
+    r.reference = false;
+    
+    std::promise<int> done;
+    std::future<int> result = done.get_future();
+    {
+      std::lock_guard<std::mutex> lock(save_mutex);
+      if(pending_save != nullptr)
+        r.waiting.swap(pending_save->waiting);
+      r.waiting.push_back(std::move(done));
+      pending_save.reset(new SaveRequest(std::move(r)));
+      
+      if(!save_thread.joinable())
+        save_thread = std::thread([this](){ writeSaves(); });
+    }
+    save_ready.notify_one();
+    
+    return result;
+  }
+  
+  // Add group to parent, a group of this file, and append the change to the
+  // journal. Load replays the journal after reading the file, save and
+  // compact fold it into the file. The journal is next to the file, named
+  // as the file with the ".journal" extension appended.
+  int appendGroup(std::shared_ptr<Group> parent, std::shared_ptr<Group> group){
+    Journal::Record record;
+    record.type = Journal::ADD_GROUP_RECORD;
+    if(pathOf(parent.get(), record.path) != 0)
+      return 1;
+    
+    if(parent->addGroup(group) != 0)
+      return 1;
+    record.value = toXml(group.get());
+    return getJournal()->append(record);
+  }
+  
+  // Same, also appending value to the list domain of parent (e.g., the time
+  // of a new timestep)
+  int appendGroup(std::shared_ptr<Group> parent, std::shared_ptr<Group> group, PHY_TYPE value){
+    ListDomain<PHY_TYPE>* list = dynamic_cast<ListDomain<PHY_TYPE>*>(parent->getDomain().get());
+    if(list == nullptr){
+      fprintf(stderr, "Error: the domain of group %s is not a list\n", parent->name.c_str());
+      return 1;
+    }
+    
+    Journal::Record record;
+    record.type = Journal::ADD_GROUP_RECORD;
+    if(pathOf(parent.get(), record.path) != 0)
+      return 1;
+    
+    if(parent->addGroup(group) != 0)
+      return 1;
+    list->addDomainItem(value);
+    record.name = string_format("%.17g", value);
+    record.value = toXml(group.get());
+    return getJournal()->append(record);
+  }
+  
+  // Add variable to group and append the change to the journal
+  int appendVariable(std::shared_ptr<Group> group, std::shared_ptr<Variable> variable){
+    Journal::Record record;
+    record.type = Journal::ADD_VARIABLE_RECORD;
+    if(pathOf(group.get(), record.path) != 0)
+      return 1;
+    
+    if(variable->getParent() == nullptr)
+      variable->setParent(group.get());
+    group->addVariable(variable);
+    record.value = toXml(variable.get());
+    return getJournal()->append(record);
+  }
+  
+  // Set an attribute of group and append the change to the journal
+  int appendAttribute(std::shared_ptr<Group> group, std::string name, std::string value){
+    Journal::Record record;
+    record.type = Journal::SET_ATTRIBUTE_RECORD;
+    if(pathOf(group.get(), record.path) != 0)
+      return 1;
+    
+    group->setAttribute(name, value);
+    record.name = name;
+    record.value = value;
+    return getJournal()->append(record);
+  }
+  
+  // Fold the journal into the file on a background thread: the file is
+  // loaded with the records appended so far and written again, then those
+  // records are dropped from the journal. Only the files are used, appends
+  // can go on meanwhile but not saves of this file.
+  std::future<int> compact(){
+    std::shared_ptr<Journal> j = getJournal();
+    std::string path = file_path;
+    bool share = share_on_load;
+    bool reference = reference_on_save;
+    
+    return std::async(std::launch::async, [j, path, share, reference](){
+      uint64_t folded = j->getLastSequence();
+      if(!j->exists())
+        return 0;
+      
+      MetadataFile meta(path);
+      meta.journal = j;
+      meta.replay_up_to = folded;
+      meta.share_on_load = share;
+      meta.reference_on_save = reference;
+      if(meta.Load() != 0)
+        return 1;
+      
+      // readers see either the old file or the new one
+      SaveRequest r = meta.request();
+      r.path = path + ".compact";
+      r.folded = folded;
+      if(writeDocument(r) < 0)
+        return 1;
+      
+      std::string tmp_path = r.path;
+#if _WIN32
+      remove(path.c_str());
+#endif
+      if(rename(tmp_path.c_str(), path.c_str()) != 0){
+        fprintf(stderr, "Error: failed to replace %s\n", path.c_str());
+        return 1;
+      }
+      
+      return j->truncate(folded);
+    });
+  }
+  
+  // Journal of the file, its records are written by the append methods
+  const std::shared_ptr<Journal>& getJournal(){
+    std::string path = file_path + ".journal";
+    if(journal == nullptr || journal->getPath() != path)
+      journal = std::make_shared<Journal>(path);
+    return journal;
+  }
+
   // std::string get_idx_file_path(int timestep, int level, CenterType ctype);
   // std::string get_md_file_path(){ return file_path; }
   // int set_md_file_path(const char* new_path){ set_correct_path(new_path); return 0; }
 
   // int clear(){ groups.clear(); return 0; }
 
+  // Identical domains and variables share one instance after Load (default
+  // off). A shared instance is changed for every group that has it, and only
+  // the group it was first loaded in is marked modified, so enable it for
+  // trees that are read rather than edited.
+  int setShareOnLoad(bool share){ share_on_load = share; return 0; }
+  
+  // Sibling groups are built concurrently by Load (default off), the
+  // result is the same as a serial load, shared subtrees (setShareOnLoad)
+  // and exceptions thrown while reading included
+  int setParallelLoad(bool parallel){ parallel_load = parallel; return 0; }
+  
+  // The document is built and written on the thread pool (default off), the
+  // file is the same as a serial save. Ignored when saving references.
+  int setParallelSave(bool parallel){ parallel_save = parallel; return 0; }
+  
+  // After a selective load, the children of the root group outside the
+  // selection are read on demand from their subfiles and kept in a cache of
+  // the given size in bytes, evicting the least recently used (0 disables).
+  // The counters are kept across loads.
+  int setCacheBudget(size_t bytes){
+    if(bytes == 0)
+      cache = nullptr;
+    else if(cache != nullptr)
+      cache->setBudget(bytes);
+    else
+      cache = std::make_shared<GroupCache>(bytes);
+    
+    if(root_group != nullptr)
+      root_group->setCache(cache);
+    return 0;
+  }
+  
+  // Hit, miss and eviction counters of the cache, null when disabled
+  const std::shared_ptr<GroupCache>& getCache() const { return cache; }
+  
+  // Save only the subfiles of the children changed since the last load or
+  // save, and reuse the bytes written the previous time for the unchanged
+  // inline children of the root group (kept in memory). Changes are tracked
+  // by the mutators of the elements (see Group::markModified).
+  int setIncrementalSave(bool incremental){ incremental_save = incremental; return 0; }
+  
+  // Repeated domains and variables are saved once and referenced with XInclude
+  int setReferenceOnSave(bool reference){ reference_on_save = reference; return 0; }
+
   int setRootGroup(std::shared_ptr<Group> _root_group){
     root_group = _root_group;
     return 0;
@@ -133,6 +443,330 @@ public:
   }
   
   inline size_t getNumberOfGroups() const { return root_group->getGroups().size(); };
+  
+private:
+  
+  // What a save writes, taken when it is requested
+  struct SaveRequest{
+    std::shared_ptr<Group> root;
+    // file written, and file the references are relative to
+    std::string path;
+    std::string url;
+    // last journal record included
+    std::shared_ptr<Journal> journal;
+    uint64_t folded = 0;
+    bool parallel = false;
+    bool incremental = false;
+    bool reference = false;
+    // callers of saveAsync waiting for it
+    std::vector<std::promise<int> > waiting;
+  };
+  
+  SaveRequest request(){
+    SaveRequest r;
+    r.root = root_group;
+    r.path = file_path;
+    r.url = file_path;
+    r.journal = getJournal();
+    r.folded = r.journal->getLastSequence();
+    // references depend on the order subtrees are seen, they are saved serially
+    // and entirely
+    r.parallel = parallel_save && !reference_on_save;
+    r.incremental = incremental_save && !reference_on_save;
+    r.reference = reference_on_save;
+    return r;
+  }
+  
+  // Write the document of the root group of r, recording the journal records
+  // it includes
+  static int writeDocument(const SaveRequest& r){
+    xmlDocPtr doc = NULL;       /* document pointer */
+    xmlNodePtr root_node = NULL;/* node pointers */
+    
+    Library::init();
+    
+    createNewDoc(doc, root_node);
+    if(r.folded > 0)
+      xmlNewProp(root_node, BAD_CAST "JournalSequence", BAD_CAST std::to_string(r.folded).c_str());
+    
+    // references to shared subtrees are relative to the main file
+    size_t name_pos = r.url.find_last_of("/\\");
+    xmlFree((xmlChar*)doc->URL);
+    doc->URL = xmlStrdup(BAD_CAST r.url.substr(name_pos == std::string::npos ? 0 : name_pos+1).c_str());
+    
+    if(r.root != nullptr){
+      SubtreeTable subtrees;
+      r.root->setSubtreeTable(r.reference ? &subtrees : nullptr);
+      r.root->setParallelSerialize(r.parallel);
+      r.root->setIncrementalSave(r.incremental);
+      r.root->serialize(root_node);
+      r.root->setIncrementalSave(false);
+      r.root->setParallelSerialize(false);
+      r.root->setSubtreeTable(nullptr);
+    }
+    
+    if(r.parallel || r.incremental)
+      return saveDocSpliced(r.path, doc, r.root, r.parallel, r.incremental);
+    else
+      return saveDoc(r.path, doc);
+  }
+  
+  // Write the saves requested by saveAsync, the last one replacing those
+  // not started yet
+  void writeSaves(){
+    std::unique_lock<std::mutex> lock(save_mutex);
+    while(true){
+      save_ready.wait(lock, [this](){ return pending_save != nullptr || stopping; });
+      if(pending_save == nullptr)
+        return;
+      
+      std::unique_ptr<SaveRequest> r(std::move(pending_save));
+      lock.unlock();
+      
+      int ret = writeDocument(*r);
+      if(ret >= 0 && r->folded > 0)
+        r->journal->truncate(r->folded);
+      
+      for(auto& w: r->waiting)
+        w.set_value(ret >= 0 ? 0 : 1);
+      
+      lock.lock();
+    }
+  }
+  
+  // Indices of the child groups leading from the root group to group
+  int pathOf(Group* group, std::vector<uint32_t>& path){
+    path.clear();
+    for(Group* g = group; g != root_group.get(); ){
+      Parsable* p = g == nullptr ? nullptr : g->getParent();
+      if(p == nullptr || p->getClassName() != "Group"){
+        fprintf(stderr, "Error: the group is not in %s\n", file_path.c_str());
+        return 1;
+      }
+      
+      Group* parent = static_cast<Group*>(p);
+      const std::vector<std::shared_ptr<Group> >& children = parent->getGroups();
+      size_t i = 0;
+      while(i < children.size() && children[i].get() != g)
+        i++;
+      if(i == children.size()){
+        fprintf(stderr, "Error: the group is not in %s\n", file_path.c_str());
+        return 1;
+      }
+      
+      path.push_back((uint32_t)i);
+      g = parent;
+    }
+    
+    std::reverse(path.begin(), path.end());
+    return 0;
+  }
+  
+  Group* groupAt(const std::vector<uint32_t>& path){
+    Group* g = root_group.get();
+    for(uint32_t i: path){
+      if(g == nullptr || i >= g->getGroups().size())
+        return nullptr;
+      g = g->getGroups()[i].get();
+    }
+    return g;
+  }
+  
+  // Element written as it is in the file, indented as the deserializers expect
+  static std::string toXml(Parsable* element){
+    xmlDocPtr doc = xmlNewDoc(BAD_CAST "1.0");
+    xmlNodePtr scratch = xmlNewDocNode(doc, NULL, BAD_CAST "Scratch", NULL);
+    xmlDocSetRootElement(doc, scratch);
+    
+    xmlNodePtr node = element->serialize(scratch);
+    xmlBufferPtr buffer = xmlBufferCreate();
+    xmlNodeDump(buffer, doc, node, 0, 1);
+    std::string xml((const char*)xmlBufferContent(buffer), xmlBufferLength(buffer));
+    
+    xmlBufferFree(buffer);
+    xmlFreeDoc(doc);
+    return xml;
+  }
+  
+  // Apply the journal records after the given one to the loaded groups
+  int replayJournal(uint64_t after){
+    std::vector<Journal::Record> records;
+    if(journal->read(records, after, replay_up_to) != 0)
+      return 1;
+    
+    for(auto& r: records){
+      Group* group = groupAt(r.path);
+      if(group == nullptr){
+        fprintf(stderr, "Error: record %llu of %s is not in the file\n",
+                (unsigned long long)r.sequence, journal->getPath().c_str());
+        return 1;
+      }
+      
+      if(r.type == Journal::SET_ATTRIBUTE_RECORD){
+        group->setAttribute(r.name, r.value);
+        continue;
+      }
+      
+      xmlDocPtr doc = xmlCtxtReadMemory(Library::parserContext(), r.value.data(), (int)r.value.size(), NULL, NULL, XML_PARSE_HUGE);
+      xmlNodePtr node = doc == NULL ? NULL : xmlDocGetRootElement(doc);
+      if(node == NULL){
+        fprintf(stderr, "Error: failed to parse record %llu of %s\n",
+                (unsigned long long)r.sequence, journal->getPath().c_str());
+        if(doc != NULL)
+          xmlFreeDoc(doc);
+        return 1;
+      }
+      
+      ListDomain<PHY_TYPE>* list = dynamic_cast<ListDomain<PHY_TYPE>*>(group->getDomain().get());
+      if(r.type == Journal::ADD_GROUP_RECORD && r.name != "" && list != nullptr)
+        list->addDomainItem(strtod(r.name.c_str(), NULL));
+      
+      if(r.type == Journal::ADD_GROUP_RECORD){
+        std::shared_ptr<Group> g(new Group(""));
+        g->deserialize(node, group);
+        if(group->addGroup(g) != 0)
+          fprintf(stderr, "Error: record %llu of %s adds a child to a group with a template\n",
+                  (unsigned long long)r.sequence, journal->getPath().c_str());
+      }
+      else{
+        std::shared_ptr<Variable> v(new Variable(group));
+        v->deserialize(node, group);
+        group->addVariable(v);
+      }
+      
+      xmlFreeDoc(doc);
+    }
+    
+    return 0;
+  }
+  
+  // Write doc as saveDoc does, dumping the children of the top group into
+  // separate buffers (concurrently when parallel). The children are replaced
+  // by placeholder comments in the skeleton, which is dumped last and spliced
+  // with them. With incremental, the bytes of each child group are kept for
+  // the next save and the unchanged ones (left as placeholders by
+  // Group::serialize) reuse the bytes of the previous save.
+  static int saveDocSpliced(const std::string &path, xmlDocPtr doc, const std::shared_ptr<Group>& root_group,
+                            bool parallel, bool incremental){
+    xmlNodePtr top = NULL;
+    for(xmlNodePtr n = xmlDocGetRootElement(doc)->children; n && top == NULL; n = n->next)
+      if(elementOf(n) == Element::GROUP_ELEMENT)
+        top = n;
+    
+    // the nodes of the child groups follow the order of the groups
+    std::vector<xmlNodePtr> parts;
+    std::vector<std::shared_ptr<Group> > owners;
+    if(top != NULL){
+      const std::vector<std::shared_ptr<Group> >& children = root_group->getGroups();
+      size_t g = 0;
+      for(xmlNodePtr n = top->children; n; n = n->next){
+        bool placeholder = n->type == XML_COMMENT_NODE && xmlStrEqual(n->content, BAD_CAST Group::savedPlaceholder());
+        if(n->type != XML_ELEMENT_NODE && !placeholder)
+          continue;
+        
+        bool is_group = placeholder || elementOf(n) == Element::GROUP_ELEMENT;
+        std::shared_ptr<Group> owner = is_group && incremental && g < children.size() ? children[g] : nullptr;
+        if(is_group)
+          g++;
+        
+        // without the bytes of its group a placeholder is left in place
+        if(placeholder && (owner == nullptr || owner->saved_xml.empty()))
+          continue;
+        
+        parts.push_back(n);
+        owners.push_back(owner);
+      }
+    }
+    
+    if(parts.size() < 2 && !incremental)
+      return saveDoc(path, doc);
+    
+    // nested elements are indented from the level of the top group children
+    int level = 1;
+    for(xmlNodePtr n = top; n != NULL && n->parent != NULL && n->parent->type == XML_ELEMENT_NODE; n = n->parent)
+      level++;
+    
+    std::vector<std::string> markers(parts.size());
+    std::vector<bool> saved(parts.size(), false);
+    for(size_t i=0; i < parts.size(); i++){
+      markers[i] = "xidx-part-" + std::to_string(i);
+      saved[i] = parts[i]->type == XML_COMMENT_NODE;
+      if(saved[i])
+        xmlNodeSetContent(parts[i], BAD_CAST markers[i].c_str());
+      else
+        xmlReplaceNode(parts[i], xmlNewDocComment(doc, BAD_CAST markers[i].c_str()));
+    }
+    
+    // attributes are escaped according to the document encoding, which the
+    // document dump also sets while writing
+    const xmlChar* doc_encoding = doc->encoding;
+    doc->encoding = BAD_CAST "UTF-8";
+    
+    std::vector<std::string> buffers(parts.size());
+    auto dump = [&](size_t i){
+      if(saved[i])
+        return;
+      
+      xmlOutputBufferPtr out = xmlAllocOutputBuffer(NULL);
+      xmlNodeDumpOutput(out, doc, parts[i], level, 1, "UTF-8");
+      xmlOutputBufferFlush(out);
+      buffers[i].assign((const char*)xmlOutputBufferGetContent(out), xmlOutputBufferGetSize(out));
+      xmlOutputBufferClose(out);
+      xmlFreeNode(parts[i]);
+    };
+    
+    if(parallel)
+      ThreadPool::global().parallelFor(parts.size(), dump);
+    else
+      for(size_t i=0; i < parts.size(); i++)
+        dump(i);
+    
+    doc->encoding = doc_encoding;
+    
+    xmlChar* skeleton = NULL;
+    int size = 0;
+    xmlDocDumpFormatMemoryEnc(doc, &skeleton, &size, "UTF-8", 1);
+    xmlFreeDoc(doc);
+    
+    if(skeleton == NULL){
+      fprintf(stderr, "Error: failed to write %s\n", path.c_str());
+      return -1;
+    }
+    
+    FILE* file = fopen(path.c_str(), "wb");
+    if(file == NULL){
+      fprintf(stderr, "Error: failed to open %s\n", path.c_str());
+      xmlFree(skeleton);
+      return -1;
+    }
+    
+    const char* text = (const char*)skeleton;
+    size_t pos = 0;
+    long written = 0;
+    for(size_t i=0; i < parts.size(); i++){
+      std::string comment = "<!--" + markers[i] + "-->";
+      const char* at = strstr(text + pos, comment.c_str());
+      if(at == NULL)
+        break;
+      
+      const std::string& part = saved[i] ? owners[i]->saved_xml : buffers[i];
+      written += fwrite(text + pos, 1, at - (text + pos), file);
+      written += fwrite(part.data(), 1, part.size(), file);
+      pos = (at - text) + comment.size();
+    }
+    written += fwrite(text + pos, 1, size - pos, file);
+    
+    xmlFree(skeleton);
+    if(fclose(file) != 0)
+      return -1;
+    
+    // kept for the next incremental save
+    for(size_t i=0; i < parts.size(); i++)
+      if(!saved[i] && owners[i] != nullptr)
+        owners[i]->saved_xml.swap(buffers[i]);
+    
+    return (int)written;
+  }
 };
 
 }
@@ -0,0 +1,444 @@
+/*
+ * Copyright (c) 2017 University of Utah
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef XIDX_JOURNAL_H_
+#define XIDX_JOURNAL_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "xidx_config.h"
+
+namespace xidx{
+
+// Append-only log of the changes made to a metadata file since it was last
+// written, kept next to it (see MetadataFile::setJournal).
+//
+// The file starts with a magic string and the sequence number of the last
+// record already folded into the XML, followed by the records. Each record is
+// its payload size and checksum (32 bits, little endian) and the payload:
+// type, sequence number, path of the group, name and value. A record that is
+// torn or corrupted (e.g., by a crash during an append) ends the log.
+class Journal{
+
+public:
+  enum RecordType{
+    ADD_GROUP_RECORD = 0,
+    ADD_VARIABLE_RECORD = 1,
+    SET_ATTRIBUTE_RECORD = 2
+  };
+
+  static inline const char* toString(RecordType v)
+  {
+    switch (v)
+    {
+      case ADD_GROUP_RECORD:     return "AddGroup";
+      case ADD_VARIABLE_RECORD:  return "AddVariable";
+      case SET_ATTRIBUTE_RECORD: return "SetAttribute";
+      default:                   return "[Unknown]";
+    }
+  }
+
+  struct Record{
+    RecordType type = ADD_GROUP_RECORD;
+    uint64_t sequence = 0;
+    // indices of the child groups leading from the root group to the group changed
+    std::vector<uint32_t> path;
+    // name of the attribute, value added to the list domain of the group
+    // with a new child (if any)
+    std::string name;
+    // value of the attribute, XML of the group or variable added
+    std::string value;
+  };
+
+  Journal(std::string _path) : path(_path){ };
+
+  ~Journal(){
+    if(file != NULL)
+      fclose(file);
+  }
+
+  const std::string& getPath() const { return path; }
+
+  // Sync each append to the device (default XIDX_JOURNAL_SYNC), otherwise
+  // the records survive a crash of the process but not of the system
+  int setSync(bool _sync){ sync = _sync; return 0; }
+
+  // Number the record after the last one and append it
+  int append(Record& record){
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if(file == NULL && openForAppend() != 0)
+      return 1;
+
+    record.sequence = last_sequence + 1;
+
+    std::string payload;
+    encode(record, payload);
+    std::string frame;
+    putFixed(frame, (uint32_t)payload.size(), 4);
+    putFixed(frame, checksum(payload), 4);
+    frame += payload;
+
+    if(fwrite(frame.data(), 1, frame.size(), file) != frame.size() || fflush(file) != 0){
+      fprintf(stderr, "Error: failed to append to %s\n", path.c_str());
+      // the torn record is dropped when the log is opened again
+      fclose(file);
+      file = NULL;
+      return 1;
+    }
+
+    if(sync)
+      syncFile(file);
+
+    last_sequence = record.sequence;
+    return 0;
+  }
+
+  // Read the records with sequence number after `after` and up to `up_to`
+  // (0 for all of them)
+  int read(std::vector<Record>& records, uint64_t after = 0, uint64_t up_to = 0){
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<Record> all;
+    uint64_t base = 0;
+    size_t valid = 0;
+    if(scan(all, base, valid) != 0)
+      return 1;
+
+    for(auto& r: all)
+      if(r.sequence > after && (up_to == 0 || r.sequence <= up_to))
+        records.push_back(r);
+
+    return 0;
+  }
+
+  // Drop the records up to the given sequence number, once they are folded
+  // into the XML. The file is replaced atomically.
+  int truncate(uint64_t sequence){
+    std::lock_guard<std::mutex> lock(mutex);
+
+    last_sequence = std::max(last_sequence, sequence);
+    if(file == NULL && !exists())
+      return 0;
+
+    std::vector<Record> all;
+    uint64_t base = 0;
+    size_t valid = 0;
+    if(scan(all, base, valid) != 0)
+      return 1;
+
+    std::vector<Record> kept;
+    for(auto& r: all)
+      if(r.sequence > sequence)
+        kept.push_back(r);
+
+    return rewrite(kept, std::max(base, sequence));
+  }
+
+  // The records up to the given sequence number are in the XML, the
+  // numbering of the appended ones continues after it
+  int setFolded(uint64_t sequence){
+    std::lock_guard<std::mutex> lock(mutex);
+    last_sequence = std::max(last_sequence, sequence);
+    return 0;
+  }
+
+  // Sequence number of the last record, or of the last folded into the XML
+  uint64_t getLastSequence(){
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if(!scanned){
+      std::vector<Record> all;
+      uint64_t base = 0;
+      size_t valid = 0;
+      scan(all, base, valid);
+    }
+
+    return last_sequence;
+  }
+
+  bool exists() const {
+    FILE* f = fopen(path.c_str(), "rb");
+    if(f == NULL)
+      return false;
+    fclose(f);
+    return true;
+  }
+
+private:
+  std::string path;
+  std::mutex mutex;
+  FILE* file = NULL;
+  bool sync = XIDX_JOURNAL_SYNC;
+  bool scanned = false;
+  uint64_t last_sequence = 0;
+
+  static const char* magic(){ return "XIDXJNL1"; }
+  static const size_t header_size = 16;
+
+  static void putFixed(std::string& out, uint64_t v, int bytes){
+    for(int i=0; i < bytes; i++)
+      out.push_back((char)((v >> (8*i)) & 0xff));
+  }
+
+  static void putVarint(std::string& out, uint64_t v){
+    while(v >= 0x80){
+      out.push_back((char)((v & 0x7f) | 0x80));
+      v >>= 7;
+    }
+    out.push_back((char)v);
+  }
+
+  static bool getFixed(const std::string& in, size_t& pos, uint64_t& v, int bytes){
+    if(pos + bytes > in.size())
+      return false;
+    v = 0;
+    for(int i=0; i < bytes; i++)
+      v |= (uint64_t)(unsigned char)in[pos+i] << (8*i);
+    pos += bytes;
+    return true;
+  }
+
+  static bool getVarint(const std::string& in, size_t& pos, uint64_t& v){
+    v = 0;
+    for(int shift=0; shift < 64 && pos < in.size(); shift += 7){
+      unsigned char c = (unsigned char)in[pos++];
+      v |= (uint64_t)(c & 0x7f) << shift;
+      if((c & 0x80) == 0)
+        return true;
+    }
+    return false;
+  }
+
+  static bool getString(const std::string& in, size_t& pos, std::string& s){
+    uint64_t size = 0;
+    if(!getVarint(in, pos, size) || size > in.size() - pos)
+      return false;
+    s.assign(in, pos, size);
+    pos += size;
+    return true;
+  }
+
+  // FNV-1a
+  static uint32_t checksum(const std::string& data){
+    uint32_t h = 2166136261u;
+    for(unsigned char c: data){
+      h ^= c;
+      h *= 16777619u;
+    }
+    return h;
+  }
+
+  static void syncFile(FILE* f){
+#if _WIN32
+    _commit(_fileno(f));
+#else
+    fsync(fileno(f));
+#endif
+  }
+
+  static void encode(const Record& r, std::string& out){
+    out.push_back((char)r.type);
+    putFixed(out, r.sequence, 8);
+    putVarint(out, r.path.size());
+    for(uint32_t i: r.path)
+      putVarint(out, i);
+    putVarint(out, r.name.size());
+    out += r.name;
+    putVarint(out, r.value.size());
+    out += r.value;
+  }
+
+  static bool decode(const std::string& in, Record& r){
+    size_t pos = 0;
+    uint64_t v = 0;
+    if(!getFixed(in, pos, v, 1) || v > SET_ATTRIBUTE_RECORD)
+      return false;
+    r.type = (RecordType)v;
+
+    if(!getFixed(in, pos, r.sequence, 8) || !getVarint(in, pos, v) || v > in.size())
+      return false;
+
+    r.path.resize(v);
+    for(auto& i: r.path){
+      if(!getVarint(in, pos, v))
+        return false;
+      i = (uint32_t)v;
+    }
+
+    return getString(in, pos, r.name) && getString(in, pos, r.value) && pos == in.size();
+  }
+
+  static std::string header(uint64_t base){
+    std::string out(magic());
+    putFixed(out, base, 8);
+    return out;
+  }
+
+  // Read the whole log, valid is the size of its intact prefix
+  int scan(std::vector<Record>& records, uint64_t& base, size_t& valid){
+    base = 0;
+    valid = 0;
+
+    if(file != NULL)
+      fflush(file);
+
+    FILE* f = fopen(path.c_str(), "rb");
+    if(f == NULL){
+      scanned = true;
+      return 0;
+    }
+
+    std::string data;
+    char buffer[1 << 16];
+    size_t n;
+    while((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+      data.append(buffer, n);
+    fclose(f);
+
+    size_t pos = 0;
+    if(data.size() < header_size || data.compare(0, 8, magic()) != 0){
+      fprintf(stderr, "Error: %s is not a metadata journal\n", path.c_str());
+      return 1;
+    }
+    pos = 8;
+    getFixed(data, pos, base, 8);
+    valid = pos;
+
+    uint64_t last = base;
+    while(true){
+      uint64_t size = 0, sum = 0;
+      if(!getFixed(data, pos, size, 4) || !getFixed(data, pos, sum, 4) || size > data.size() - pos)
+        break;
+
+      std::string payload(data, pos, size);
+      Record r;
+      if(checksum(payload) != (uint32_t)sum || !decode(payload, r) || r.sequence <= last)
+        break;
+
+      pos += size;
+      valid = pos;
+      last = r.sequence;
+      records.push_back(r);
+    }
+
+    if(valid < data.size())
+      fprintf(stderr, "Warning: %s ends with a torn record, ignored\n", path.c_str());
+
+    last_sequence = std::max(last_sequence, last);
+    scanned = true;
+    return 0;
+  }
+
+  // Replace the log with the given records through a temporary file
+  int rewrite(const std::vector<Record>& records, uint64_t base){
+    if(file != NULL){
+      fclose(file);
+      file = NULL;
+    }
+
+    std::string data = header(base);
+    for(auto& r: records){
+      std::string payload;
+      encode(r, payload);
+      putFixed(data, (uint32_t)payload.size(), 4);
+      putFixed(data, checksum(payload), 4);
+      data += payload;
+    }
+
+    std::string tmp_path = path + ".tmp";
+    FILE* f = fopen(tmp_path.c_str(), "wb");
+    if(f == NULL){
+      fprintf(stderr, "Error: failed to open %s\n", tmp_path.c_str());
+      return 1;
+    }
+
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size() && fflush(f) == 0;
+    if(ok && sync)
+      syncFile(f);
+    ok = fclose(f) == 0 && ok;
+
+#if _WIN32
+    // rename does not replace an existing file
+    remove(path.c_str());
+#endif
+    if(!ok || rename(tmp_path.c_str(), path.c_str()) != 0){
+      fprintf(stderr, "Error: failed to write %s\n", path.c_str());
+      remove(tmp_path.c_str());
+      return 1;
+    }
+
+    return 0;
+  }
+
+  // A missing log is created, a torn record at its end is dropped
+  int openForAppend(){
+    std::vector<Record> records;
+    uint64_t base = 0;
+    size_t valid = 0;
+    if(scan(records, base, valid) != 0)
+      return 1;
+
+    FILE* f = fopen(path.c_str(), "rb");
+    bool missing = f == NULL;
+    long size = 0;
+    if(f != NULL){
+      fseek(f, 0, SEEK_END);
+      size = ftell(f);
+      fclose(f);
+    }
+
+    if(missing || (size_t)size != valid)
+      if(rewrite(records, missing ? last_sequence : base) != 0)
+        return 1;
+
+    file = fopen(path.c_str(), "ab");
+    if(file == NULL){
+      fprintf(stderr, "Error: failed to open %s\n", path.c_str());
+      return 1;
+    }
+
+    return 0;
+  }
+};
+
+}
+
+#endif
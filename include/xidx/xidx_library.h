@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2017 University of Utah
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef XIDX_LIBRARY_H_
+#define XIDX_LIBRARY_H_
+
+#include <mutex>
+#include <set>
+#include <libxml/parser.h>
+#include <libxml/xmlmemory.h>
+
+#include "xidx_config.h"
+
+namespace xidx{
+
+// Setup of libxml shared by all the metadata files of the process. It is
+// initialized once, on first use, and torn down only by cleanup, so that
+// tools reading and writing many files (possibly from several threads)
+// do not pay for it on every Load and save.
+class Library{
+
+public:
+  // Check the libxml version and initialize the parser, done by the readers
+  // and writers of the library (and by cleanup if called before)
+  static void init(){
+    std::lock_guard<std::mutex> lock(mutex());
+    if(!initialized()){
+      LIBXML_TEST_VERSION;
+      xmlInitParser();
+      initialized() = true;
+    }
+  }
+  
+  // Free the global state of libxml, once no thread uses it anymore (e.g.,
+  // at the end of a tool). The parser contexts of all the threads are freed
+  // first, and everything is initialized again on the next use.
+  static void cleanup(){
+    std::lock_guard<std::mutex> lock(mutex());
+    if(initialized()){
+      for(Context* context: contexts()){
+        if(context->ctxt != NULL)
+          xmlFreeParserCtxt(context->ctxt);
+        context->ctxt = NULL;
+      }
+      xmlCleanupParser();
+      initialized() = false;
+    }
+  }
+  
+  // Dump the memory allocated by libxml (to .memdump, with a debug build of
+  // libxml) after each save, to debug memory in regression tests. Default
+  // XIDX_MEMORY_DUMP.
+  static void setMemoryDump(bool dump){ memoryDump() = dump; }
+  static bool getMemoryDump(){ return memoryDump(); }
+  
+  // Parser context of the calling thread, reused for every document it reads
+  // (e.g., with xmlCtxtReadFile) along with its dictionary. Handlers changed
+  // for a document must be restored afterwards.
+  static xmlParserCtxtPtr parserContext(){
+    init();
+    
+    static thread_local Context context;
+    
+    if(context.ctxt == NULL){
+      std::lock_guard<std::mutex> lock(mutex());
+      context.ctxt = xmlNewParserCtxt();
+    }
+    return context.ctxt;
+  }
+
+private:
+  // Parser context of a thread, registered so that cleanup can free it
+  // before the thread exits
+  struct Context{
+    xmlParserCtxtPtr ctxt = NULL;
+    
+    Context(){
+      std::lock_guard<std::mutex> lock(mutex());
+      contexts().insert(this);
+    }
+    
+    ~Context(){
+      std::lock_guard<std::mutex> lock(mutex());
+      contexts().erase(this);
+      if(ctxt != NULL)
+        xmlFreeParserCtxt(ctxt);
+    }
+  };
+  
+  static std::set<Context*>& contexts(){
+    static std::set<Context*> live;
+    return live;
+  }
+  
+  static std::mutex& mutex(){
+    static std::mutex m;
+    return m;
+  }
+  
+  static bool& initialized(){
+    static bool value = false;
+    return value;
+  }
+  
+  static bool& memoryDump(){
+    static bool value = XIDX_MEMORY_DUMP;
+    return value;
+  }
+};
+
+}
+
+#endif
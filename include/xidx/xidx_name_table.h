@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2017 University of Utah
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef XIDX_NAME_TABLE_H_
+#define XIDX_NAME_TABLE_H_
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <libxml/tree.h>
+
+namespace xidx{
+
+// FNV-1a hash of a NUL terminated name, constant when the name is (e.g., to
+// use it as a case label)
+constexpr uint32_t hashName(const char* name, uint32_t h = 2166136261u){
+  return *name == '\0' ? h : hashName(name + 1, (h ^ static_cast<unsigned char>(*name)) * 16777619u);
+}
+
+// Lookup from the names of an enumeration to its values, built once from its
+// toString so that parsing and formatting share the same names. The table is
+// grown until every name has its own slot (a perfect hash of the names), so
+// a lookup hashes the string and compares it with a single candidate.
+template<typename E>
+class NameTable{
+  
+private:
+  struct Slot{
+    const char* name = nullptr;
+    E value;
+  };
+  
+  std::vector<Slot> slots;
+  uint32_t mask = 0;
+  
+public:
+  // Names of the values from first to last (included)
+  NameTable(int first, int last, const char* (*to_string)(E)){
+    size_t size = 1;
+    while(size < 2 * static_cast<size_t>(last - first + 1))
+      size <<= 1;
+    
+    while(!build(first, last, to_string, size))
+      size <<= 1;
+  }
+  
+  // Set value to the one named name, false (leaving value as is) if there
+  // is none
+  bool find(const char* name, E& value) const{
+    if(name == nullptr)
+      return false;
+    
+    const Slot& slot = slots[hashName(name) & mask];
+    if(slot.name == nullptr || strcmp(slot.name, name) != 0)
+      return false;
+    
+    value = slot.value;
+    return true;
+  }
+  
+private:
+  bool build(int first, int last, const char* (*to_string)(E), size_t size){
+    slots.assign(size, Slot());
+    mask = static_cast<uint32_t>(size - 1);
+    
+    for(int t = first; t <= last; t++){
+      E v = static_cast<E>(t);
+      Slot& slot = slots[hashName(to_string(v)) & mask];
+      if(slot.name != nullptr && strcmp(slot.name, to_string(v)) == 0)
+        continue; // the first value with a name wins
+      if(slot.name != nullptr)
+        return false;
+      
+      slot.name = to_string(v);
+      slot.value = v;
+    }
+    
+    return true;
+  }
+};
+
+// Elements of the metadata, to dispatch on the name of a node with a switch
+class Element{
+public:
+  enum ElementType{
+    UNKNOWN_ELEMENT = 0,
+    XIDX_ELEMENT = 1,
+    GROUP_ELEMENT = 2,
+    DOMAIN_ELEMENT = 3,
+    VARIABLE_ELEMENT = 4,
+    ATTRIBUTE_ELEMENT = 5,
+    DATA_ITEM_ELEMENT = 6,
+    DATA_SOURCE_ELEMENT = 7,
+    TOPOLOGY_ELEMENT = 8,
+    GEOMETRY_ELEMENT = 9,
+    TABLE_ELEMENT = 10,
+    INCLUDE_ELEMENT = 11
+  };
+  
+  static inline const char* toString(ElementType v)
+  {
+    switch (v)
+    {
+      case XIDX_ELEMENT:          return "Xidx";
+      case GROUP_ELEMENT:         return "Group";
+      case DOMAIN_ELEMENT:        return "Domain";
+      case VARIABLE_ELEMENT:      return "Variable";
+      case ATTRIBUTE_ELEMENT:     return "Attribute";
+      case DATA_ITEM_ELEMENT:     return "DataItem";
+      case DATA_SOURCE_ELEMENT:   return "DataSource";
+      case TOPOLOGY_ELEMENT:      return "Topology";
+      case GEOMETRY_ELEMENT:      return "Geometry";
+      case TABLE_ELEMENT:         return "Table";
+      case INCLUDE_ELEMENT:       return "include";
+      default:                    return "[Unknown]";
+    }
+  }
+  
+  static inline bool fromString(const char* s, ElementType& v){
+    static const NameTable<ElementType> table(XIDX_ELEMENT, INCLUDE_ELEMENT, toString);
+    return table.find(s, v);
+  }
+};
+
+// Element of an XML node, UNKNOWN_ELEMENT for any other node
+inline Element::ElementType elementOf(xmlNode* node){
+  Element::ElementType type = Element::ElementType::UNKNOWN_ELEMENT;
+  if(node->type == XML_ELEMENT_NODE)
+    Element::fromString(reinterpret_cast<const char*>(node->name), type);
+  return type;
+}
+
+}
+#endif
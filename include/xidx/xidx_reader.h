@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2017 University of Utah
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef XIDX_READER_H_
+#define XIDX_READER_H_
+
+#include <deque>
+#include <libxml/parser.h>
+#include <libxml/parserInternals.h>
+#include <libxml/SAX2.h>
+
+#include "xidx.h"
+
+namespace xidx{
+
+// Parse a metadata document, the inline arrays of XML DataItems larger than
+// XIDX_STREAM_DECODE_THRESHOLD are decoded chunk by chunk while the parser
+// streams and attached to the DataItem node (node->_private) instead of
+// being copied in a text node. The document is freed with the reader, as
+// are the attribute values merged by getProp (see MergedValues).
+class DocumentReader{
+
+public:
+  DocumentReader(size_t _threshold=XIDX_STREAM_DECODE_THRESHOLD) : threshold(_threshold){ }
+  
+  ~DocumentReader(){
+    if(doc != NULL)
+      xmlFreeDoc(doc);
+  }
+  
+  xmlDocPtr read(const std::string& path, int options){
+    if(doc != NULL){
+      xmlFreeDoc(doc);
+      doc = NULL;
+    }
+    streamed_values.clear();
+    merged_values.clear();
+    
+    // the context of the thread is reused, with the handlers restored
+    xmlParserCtxtPtr ctxt = Library::parserContext();
+    if(ctxt == NULL)
+      return NULL;
+    
+    xmlSAXHandler handlers;
+    bool streaming = ctxt->sax != NULL && ctxt->sax->initialized == XML_SAX2_MAGIC;
+    if(streaming){
+      handlers = *ctxt->sax;
+      ctxt->sax->startElementNs = startElement;
+      ctxt->sax->endElementNs = endElement;
+      ctxt->sax->characters = characters;
+      ctxt->_private = this;
+    }
+    
+    doc = xmlCtxtReadFile(ctxt, path.c_str(), NULL, options);
+    if(doc != NULL)
+      doc->_private = &merged_values;
+    
+    if(streaming){
+      *ctxt->sax = handlers;
+      ctxt->_private = NULL;
+    }
+    resetItem();
+    
+    return doc;
+  }
+  
+  xmlDocPtr getDocument() const { return doc; }
+  
+private:
+  xmlDocPtr doc = NULL;
+  size_t threshold;
+  
+  // values of the streamed items, referenced by their nodes
+  std::deque<std::vector<double>> streamed_values;
+  
+  // attributes of the document merged by getProp
+  MergedValues merged_values;
+  
+  // state of the DataItem being parsed
+  xmlNodePtr item_node = NULL;
+  std::string pending;
+  std::vector<double>* item_values = nullptr;
+  TextValuesDecoder decoder;
+  
+  void resetItem(){
+    item_node = NULL;
+    item_values = nullptr;
+    std::string().swap(pending);
+    decoder = TextValuesDecoder();
+  }
+  
+  // Hand the buffered text of a small item back to the tree builder
+  void flushPending(void* ctx){
+    if(pending.size())
+      xmlSAX2Characters(ctx, BAD_CAST pending.c_str(), int(pending.size()));
+    pending.clear();
+  }
+  
+  static DocumentReader* getReader(void* ctx){
+    return static_cast<DocumentReader*>(static_cast<xmlParserCtxtPtr>(ctx)->_private);
+  }
+  
+  // Only inline text arrays can be decoded while streaming
+  static bool isStreamable(const xmlChar* localname, int nb_attributes, const xmlChar** attributes){
+    if(!xmlStrEqual(localname, BAD_CAST "DataItem"))
+      return false;
+    
+    for(int i=0; i < nb_attributes; i++){
+      const xmlChar** att = attributes + 5*i;
+      std::string value((const char*)att[3], att[4]-att[3]);
+      
+      if(xmlStrEqual(att[0], BAD_CAST "Format") && value != DataItem::toString(DataItem::FormatType::XML_FORMAT))
+        return false;
+      if(xmlStrEqual(att[0], BAD_CAST "Encoding") && value != Encoding::toString(Encoding::EncodingType::TEXT_ENCODING))
+        return false;
+    }
+    
+    return true;
+  }
+  
+  static void startElement(void* ctx, const xmlChar* localname, const xmlChar* prefix, const xmlChar* URI,
+                           int nb_namespaces, const xmlChar** namespaces,
+                           int nb_attributes, int nb_defaulted, const xmlChar** attributes){
+    DocumentReader* reader = getReader(ctx);
+    
+    // mixed content, keep the text collected so far in the tree
+    if(reader->item_node != NULL && reader->item_values == nullptr){
+      reader->flushPending(ctx);
+      reader->resetItem();
+    }
+    
+    xmlSAX2StartElementNs(ctx, localname, prefix, URI, nb_namespaces, namespaces, nb_attributes, nb_defaulted, attributes);
+    
+    if(reader->item_node == NULL && isStreamable(localname, nb_attributes, attributes))
+      reader->item_node = static_cast<xmlParserCtxtPtr>(ctx)->node;
+  }
+  
+  static void endElement(void* ctx, const xmlChar* localname, const xmlChar* prefix, const xmlChar* URI){
+    DocumentReader* reader = getReader(ctx);
+    xmlParserCtxtPtr ctxt = static_cast<xmlParserCtxtPtr>(ctx);
+    
+    if(reader->item_node != NULL && ctxt->node == reader->item_node){
+      if(reader->item_values != nullptr){
+        reader->decoder.finish(*reader->item_values);
+        reader->item_node->_private = reader->item_values;
+      }
+      else
+        reader->flushPending(ctx);
+      
+      reader->resetItem();
+    }
+    
+    xmlSAX2EndElementNs(ctx, localname, prefix, URI);
+  }
+  
+  static void characters(void* ctx, const xmlChar* ch, int len){
+    DocumentReader* reader = getReader(ctx);
+    xmlParserCtxtPtr ctxt = static_cast<xmlParserCtxtPtr>(ctx);
+    
+    if(reader->item_node == NULL || ctxt->node != reader->item_node){
+      xmlSAX2Characters(ctx, ch, len);
+      return;
+    }
+    
+    if(reader->item_values != nullptr){
+      reader->decoder.feed((const char*)ch, len, *reader->item_values);
+      return;
+    }
+    
+    reader->pending.append((const char*)ch, len);
+    
+    // too large to be kept as text, switch to incremental decoding
+    if(reader->pending.size() > reader->threshold){
+      reader->streamed_values.emplace_back();
+      reader->item_values = &reader->streamed_values.back();
+      reader->decoder.feed(reader->pending.c_str(), reader->pending.size(), *reader->item_values);
+      std::string().swap(reader->pending);
+    }
+  }
+  
+};
+
+}
+
+#endif
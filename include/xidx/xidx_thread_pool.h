@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2017 University of Utah
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef XIDX_THREAD_POOL_H_
+#define XIDX_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "xidx_config.h"
+
+namespace xidx{
+
+// Fixed set of worker threads consuming a shared queue of tasks
+class ThreadPool{
+
+public:
+  explicit ThreadPool(unsigned n_threads){
+    for(unsigned i=0; i < n_threads; i++)
+      workers.emplace_back([this](){ work(); });
+  }
+  
+  ~ThreadPool(){
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex);
+      stopping = true;
+    }
+    queue_cv.notify_all();
+    for(auto& w: workers)
+      w.join();
+  }
+  
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  
+  // Pool used by the library, the calling thread counts as one of the
+  // XIDX_MAX_THREADS (0 means one per hardware thread)
+  static ThreadPool& global(){
+    static ThreadPool pool(defaultNumberOfWorkers());
+    return pool;
+  }
+  
+  unsigned getNumberOfWorkers() const { return unsigned(workers.size()); }
+  
+  // While in scope, loops started by the calling thread wait for their own
+  // iterations without running other queued tasks, so that a thread holding
+  // a lock does not re-enter code that takes the same lock
+  class OwnTasksOnly{
+  public:
+    OwnTasksOnly(){ ownTasksOnly()++; }
+    ~OwnTasksOnly(){ ownTasksOnly()--; }
+    
+    OwnTasksOnly(const OwnTasksOnly&) = delete;
+    OwnTasksOnly& operator=(const OwnTasksOnly&) = delete;
+  };
+  
+  template<typename F>
+  std::future<void> submit(F f){
+    std::shared_ptr<std::packaged_task<void()> > task = std::make_shared<std::packaged_task<void()> >(f);
+    std::future<void> result = task->get_future();
+    
+    if(workers.empty()){
+      (*task)();
+      return result;
+    }
+    
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex);
+      tasks.emplace_back([task](){ (*task)(); });
+    }
+    queue_cv.notify_one();
+    
+    return result;
+  }
+  
+  // Call fn(i) for every i in [0, n), the calling thread takes part in the
+  // work so that loops can be nested inside tasks of the same pool. An
+  // exception thrown by fn does not stop the other iterations, the first one
+  // is rethrown on the calling thread once they are all done.
+  template<typename F>
+  void parallelFor(size_t n, const F& fn){
+    if(n == 0)
+      return;
+    
+    if(workers.empty() || n == 1){
+      for(size_t i=0; i < n; i++)
+        fn(i);
+      return;
+    }
+    
+    struct Loop{
+      std::atomic<size_t> next{0};
+      std::atomic<size_t> done{0};
+      std::mutex error_mutex;
+      std::exception_ptr error;
+    };
+    std::shared_ptr<Loop> loop = std::make_shared<Loop>();
+    
+    // helpers that start after the loop is over touch only the counters
+    const F* body = &fn;
+    auto run = [loop, body, n](){
+      for(size_t i = loop->next++; i < n; i = loop->next++){
+        try{
+          (*body)(i);
+        }
+        catch(...){
+          std::lock_guard<std::mutex> lock(loop->error_mutex);
+          if(loop->error == nullptr)
+            loop->error = std::current_exception();
+        }
+        loop->done++;
+      }
+    };
+    
+    size_t n_helpers = std::min<size_t>(workers.size(), n-1);
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex);
+      for(size_t h=0; h < n_helpers; h++)
+        tasks.emplace_back(run);
+    }
+    queue_cv.notify_all();
+    
+    run();
+    bool own_only = ownTasksOnly() > 0;
+    while(loop->done.load() < n){
+      if(own_only || !runPendingTask())
+        std::this_thread::yield();
+    }
+    
+    if(loop->error != nullptr)
+      std::rethrow_exception(loop->error);
+  }
+  
+private:
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()> > tasks;
+  std::mutex queue_mutex;
+  std::condition_variable queue_cv;
+  bool stopping = false;
+  
+  static int& ownTasksOnly(){
+    static thread_local int depth = 0;
+    return depth;
+  }
+  
+  static unsigned defaultNumberOfWorkers(){
+    unsigned n = XIDX_MAX_THREADS > 0 ? XIDX_MAX_THREADS : std::thread::hardware_concurrency();
+    return n > 1 ? n-1 : 0;
+  }
+  
+  // Run a queued task on the calling thread, false if there is none
+  bool runPendingTask(){
+    std::function<void()> task;
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex);
+      if(tasks.empty())
+        return false;
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    task();
+    return true;
+  }
+  
+  void work(){
+    while(true){
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        queue_cv.wait(lock, [this](){ return stopping || !tasks.empty(); });
+        if(stopping && tasks.empty())
+          return;
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+      task();
+    }
+  }
+  
+};
+
+}
+
+#endif
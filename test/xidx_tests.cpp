@@ -0,0 +1,1175 @@
+/*
+ * Copyright (c) 2017 University of Utah
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xidx/xidx.h"
+
+using namespace xidx;
+
+// Round trips of the library, run by ctest with the name of a test as
+// argument. Each test writes its files in the working directory.
+
+static int failures = 0;
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+static void check(bool ok, const char* what, int line){
+  if(!ok){
+    fprintf(stderr, "line %d: check failed: %s\n", line, what);
+    failures++;
+  }
+}
+
+static std::string readFile(const std::string& path){
+  std::string content;
+  FILE* file = fopen(path.c_str(), "rb");
+  if(file == NULL)
+    return content;
+  
+  char block[4096];
+  size_t n;
+  while((n = fread(block, 1, sizeof(block), file)) > 0)
+    content.append(block, n);
+  fclose(file);
+  return content;
+}
+
+static int writeFile(const std::string& path, const std::string& content){
+  FILE* file = fopen(path.c_str(), "wb");
+  if(file == NULL)
+    return 1;
+  size_t written = fwrite(content.data(), 1, content.size(), file);
+  return fclose(file) != 0 || written != content.size();
+}
+
+// Replace the only occurrence of from in text
+static bool replaceOnce(std::string& text, const std::string& from, const std::string& to){
+  size_t pos = text.find(from);
+  if(pos == std::string::npos || text.find(from, pos+1) != std::string::npos)
+    return false;
+  text.replace(pos, from.size(), to);
+  return true;
+}
+
+static std::string attributeOf(const std::shared_ptr<Group>& group, const std::string& name){
+  for(auto& a: group->attributes)
+    if(a.name == name)
+      return a.value;
+  return "";
+}
+
+static std::shared_ptr<Variable> variableOf(const std::shared_ptr<Group>& group, const std::string& name){
+  for(auto& v: group->getVariables())
+    if(v->name == name)
+      return v;
+  return nullptr;
+}
+
+// Child of a time series, its index is kept in the attribute "step"
+static std::shared_ptr<Group> timeStep(int t){
+  std::shared_ptr<Group> grid(new Group("Grid", Group::GroupType::SPATIAL_GROUP_TYPE,
+                                        Variability::VariabilityType::VARIABLE_VARIABILITY_TYPE));
+  std::shared_ptr<SpatialDomain> domain(new SpatialDomain("Grid"));
+  uint32_t dims[3] = {10, 20, 30};
+  double box[6] = {0, 1, 0, 1, 0, 1};
+  domain->setTopology(Topology::TopologyType::CORECT_3D_MESH_TOPOLOGY_TYPE, 3, dims);
+  domain->SetGeometry(Geometry::GeometryType::RECT_GEOMETRY_TYPE, 3, box);
+  grid->setDomain(domain);
+  
+  grid->setAttribute("step", std::to_string(t));
+  grid->addVariable("temperature", XidxDataType::NumberType::FLOAT_NUMBER_TYPE, 32);
+  grid->addVariable("pressure", XidxDataType::NumberType::FLOAT_NUMBER_TYPE, 32);
+  return grid;
+}
+
+// n steps at times 0, 1, ..., or at the bounds (t, t+0.5) of each step
+static std::shared_ptr<Group> timeSeries(int n, bool bounds){
+  std::shared_ptr<Group> root(new Group("TimeSeries", Group::GroupType::TEMPORAL_GROUP_TYPE));
+  std::shared_ptr<TemporalListDomain> time(new TemporalListDomain("Time"));
+  for(int t=0; t < n; t++){
+    if(bounds)
+      time->addDomainItems(std::vector<double>{double(t), t+0.5});
+    else
+      time->addDomainItem(double(t));
+  }
+  root->setDomain(time);
+  root->addDataSource(std::make_shared<DataSource>("data", "data.idx"));
+  
+  for(int t=0; t < n; t++)
+    root->addGroup(timeStep(t));
+  return root;
+}
+
+// n children that differ only by their box and their data source
+static std::shared_ptr<Group> tiledSeries(int n){
+  std::shared_ptr<Group> root(new Group("Tiles", Group::GroupType::TEMPORAL_GROUP_TYPE));
+  std::shared_ptr<TemporalListDomain> time(new TemporalListDomain("Time"));
+  root->setDomain(time);
+  
+  for(int t=0; t < n; t++){
+    time->addDomainItem(double(t));
+    
+    std::shared_ptr<Group> grid(new Group("Grid", Group::GroupType::SPATIAL_GROUP_TYPE,
+                                          Variability::VariabilityType::VARIABLE_VARIABILITY_TYPE));
+    std::shared_ptr<SpatialDomain> domain(new SpatialDomain("Grid"));
+    uint32_t dims[3] = {10, 20, 30};
+    double box[6] = {double(t), t+1.0, 0, 1, 0, 1};
+    domain->setTopology(Topology::TopologyType::CORECT_3D_MESH_TOPOLOGY_TYPE, 3, dims);
+    domain->SetGeometry(Geometry::GeometryType::RECT_GEOMETRY_TYPE, 3, box);
+    grid->setDomain(domain);
+    grid->addDataSource(std::make_shared<DataSource>("data", "tile_" + std::to_string(t) + ".idx"));
+    grid->addVariable("temperature", XidxDataType::NumberType::FLOAT_NUMBER_TYPE, 32);
+    root->addGroup(grid);
+  }
+  return root;
+}
+
+static int stepOf(const std::shared_ptr<Group>& group){
+  if(group == nullptr)
+    return -1;
+  std::string step = attributeOf(group, "step");
+  return step.empty() ? -1 : atoi(step.c_str());
+}
+
+// Values written with the given encoding and read back through XML,
+// by default the Dimensions are the number of values
+static bool roundTrip(const std::vector<double>& values, XidxDataType::NumberType type, int bit_precision,
+                      Encoding::EncodingType encoding, Encoding::CompressionType compression,
+                      const IndexVector& dimensions = IndexVector(), int n_components = 1){
+  DataItem item("values", nullptr);
+  item.number_type = type;
+  item.bit_precision = bit_precision;
+  item.n_components = n_components;
+  item.dimensions = dimensions;
+  if(dimensions.size() == 0 && n_components == 1)
+    item.dimensions = {INDEX_TYPE(values.size())};
+  item.setValues(values);
+  if(item.setEncoding(encoding, compression) != 0)
+    return false;
+  
+  xmlNodePtr scratch = xmlNewNode(NULL, BAD_CAST "Scratch");
+  xmlNodePtr node = item.serialize(scratch);
+  
+  Parsable* no_parent = nullptr;
+  DataItem read_back(no_parent);
+  bool same = node != NULL && read_back.deserialize(node, nullptr) == 0 &&
+    read_back.encoding_type == encoding && read_back.getValues() == values;
+  xmlFreeNode(scratch);
+  return same;
+}
+
+static void testEncoding(){
+  typedef XidxDataType::NumberType Type;
+  const std::vector<double> reals = {0, 1.5, -2.25, 1024.5, -0.125};
+  const std::vector<double> integers = {0, 7, -3, 1000, 1000, 999, -128};
+  const std::vector<double> naturals = {0, 7, 3, 1000, 255, 65535};
+  
+  CHECK(roundTrip(reals, Type::FLOAT_NUMBER_TYPE, 64, Encoding::TEXT_ENCODING, Encoding::NO_COMPRESSION));
+  CHECK(roundTrip(reals, Type::FLOAT_NUMBER_TYPE, 64, Encoding::BASE64_ENCODING, Encoding::NO_COMPRESSION));
+  CHECK(roundTrip(reals, Type::FLOAT_NUMBER_TYPE, 32, Encoding::BASE64_ENCODING, Encoding::NO_COMPRESSION));
+  CHECK(roundTrip(integers, Type::INT_NUMBER_TYPE, 16, Encoding::BASE64_ENCODING, Encoding::NO_COMPRESSION));
+  CHECK(roundTrip(naturals, Type::UINT_NUMBER_TYPE, 32, Encoding::BASE64_ENCODING, Encoding::NO_COMPRESSION));
+  CHECK(roundTrip(integers, Type::INT_NUMBER_TYPE, 32, Encoding::DELTA_VARINT_ENCODING, Encoding::NO_COMPRESSION));
+  CHECK(roundTrip(naturals, Type::UINT_NUMBER_TYPE, 64, Encoding::DELTA_VARINT_ENCODING, Encoding::NO_COMPRESSION));
+  CHECK(roundTrip(integers, Type::INT_NUMBER_TYPE, 64, Encoding::BIT_PACKED_ENCODING, Encoding::NO_COMPRESSION));
+  CHECK(roundTrip(naturals, Type::UINT_NUMBER_TYPE, 16, Encoding::BIT_PACKED_ENCODING, Encoding::NO_COMPRESSION));
+#if XIDX_HAVE_ZLIB
+  CHECK(roundTrip(reals, Type::FLOAT_NUMBER_TYPE, 64, Encoding::BASE64_ENCODING, Encoding::ZLIB_COMPRESSION));
+  CHECK(roundTrip(integers, Type::INT_NUMBER_TYPE, 32, Encoding::DELTA_VARINT_ENCODING, Encoding::ZLIB_COMPRESSION));
+  CHECK(roundTrip(naturals, Type::UINT_NUMBER_TYPE, 32, Encoding::BIT_PACKED_ENCODING, Encoding::ZLIB_COMPRESSION));
+  
+  // the inflated size is unknown without Dimensions, and counts the components
+  const std::vector<double> six = {1, 2, 3, 4, 5, 6};
+  CHECK(roundTrip(six, Type::FLOAT_NUMBER_TYPE, 32, Encoding::BASE64_ENCODING, Encoding::ZLIB_COMPRESSION, {}, 3));
+  CHECK(roundTrip(six, Type::FLOAT_NUMBER_TYPE, 32, Encoding::BASE64_ENCODING, Encoding::ZLIB_COMPRESSION, {2}, 3));
+  
+  DataItem no_dimensions("values", nullptr);
+  no_dimensions.setValues({1, 2, 3, 4, 5});
+  CHECK(no_dimensions.setEncoding(Encoding::BASE64_ENCODING, Encoding::ZLIB_COMPRESSION) == 0);
+  xmlNodePtr scratch = xmlNewNode(NULL, BAD_CAST "Scratch");
+  xmlNodePtr node = no_dimensions.serialize(scratch);
+  Parsable* no_parent = nullptr;
+  DataItem read_back(no_parent);
+  CHECK(node != NULL && read_back.deserialize(node, nullptr) == 0);
+  CHECK(read_back.getValues() == (std::vector<double>{1, 2, 3, 4, 5}));
+  xmlFreeNode(scratch);
+#endif
+  
+  // integer encodings do not apply to floats, compression needs a binary encoding
+  DataItem item("values", nullptr);
+  CHECK(item.setEncoding(Encoding::DELTA_VARINT_ENCODING) != 0);
+  CHECK(item.setEncoding(Encoding::TEXT_ENCODING, Encoding::ZLIB_COMPRESSION) != 0);
+  
+  // values that do not fit the type are rejected
+  std::vector<unsigned char> bytes;
+  CHECK(Encoding::encode(Encoding::BASE64_ENCODING, {300}, Type::UINT_NUMBER_TYPE, 8, true, bytes) != 0);
+  CHECK(Encoding::encode(Encoding::BASE64_ENCODING, {-1}, Type::UINT_NUMBER_TYPE, 32, true, bytes) != 0);
+  CHECK(Encoding::encode(Encoding::BASE64_ENCODING, {1e300}, Type::FLOAT_NUMBER_TYPE, 32, true, bytes) != 0);
+  CHECK(Encoding::encode(Encoding::DELTA_VARINT_ENCODING, {NAN}, Type::INT_NUMBER_TYPE, 32, true, bytes) != 0);
+  CHECK(Encoding::encode(Encoding::BIT_PACKED_ENCODING, {1e30}, Type::INT_NUMBER_TYPE, 64, true, bytes) != 0);
+  
+  // constant values are packed with one bit, their count needs no Dimensions
+  CHECK(roundTrip({5, 5, 5}, Type::INT_NUMBER_TYPE, 32, Encoding::BIT_PACKED_ENCODING, Encoding::NO_COMPRESSION, {}, 3));
+  
+  // counts that the data cannot hold are rejected before allocating them:
+  // 2^62 values of width 0, then of width 60
+  std::vector<unsigned char> forged = {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x40,
+                                       0, 0, 0, 0, 0, 0, 0, 0, 0};
+  std::vector<double> decoded;
+  CHECK(Encoding::decode(Encoding::BIT_PACKED_ENCODING, forged.data(), forged.size(),
+                         Type::INT_NUMBER_TYPE, 32, true, decoded) != 0);
+  CHECK(Encoding::decode(Encoding::BIT_PACKED_ENCODING, forged.data(), forged.size(),
+                         Type::INT_NUMBER_TYPE, 32, true, decoded, 4) != 0);
+  
+  DataItem forged_item("forged", nullptr);
+  forged_item.number_type = Type::INT_NUMBER_TYPE;
+  forged_item.dimensions = {4};
+  forged_item.setEncodedText(Encoding::base64Encode(forged.data(), forged.size()), Encoding::BIT_PACKED_ENCODING);
+  CHECK(forged_item.getValues().empty());
+  
+  forged.back() = 60;
+  forged.resize(forged.size() + 8, 0xFF);
+  CHECK(Encoding::decode(Encoding::BIT_PACKED_ENCODING, forged.data(), forged.size(),
+                         Type::INT_NUMBER_TYPE, 64, true, decoded) != 0);
+  CHECK(decoded.empty());
+}
+
+// The children loaded by a selection keep their index in the domain
+static void testSelection(){
+  for(int bounds=0; bounds < 2; bounds++){
+    MetadataFile meta("selection.xidx");
+    meta.setRootGroup(timeSeries(10, bounds != 0));
+    CHECK(meta.save() == 0);
+    
+    // tuples are selected by their first value
+    MetadataFile by_time("selection.xidx");
+    CHECK(by_time.LoadTimeRange(3.9, 6.1) == 0);
+    std::shared_ptr<Group> root = by_time.getRootGroup();
+    CHECK(root->isPartiallyLoaded());
+    for(int t=0; t < 10; t++){
+      std::shared_ptr<Group> g = root->getGroup(t);
+      if(t >= 4 && t <= 6)
+        CHECK(stepOf(g) == t);
+      else
+        CHECK(g == nullptr);
+    }
+    
+    MetadataFile by_index("selection.xidx");
+    CHECK(by_index.Load(7, 8) == 0);
+    root = by_index.getRootGroup();
+    CHECK(stepOf(root->getGroup(7)) == 7);
+    CHECK(stepOf(root->getGroup(8)) == 8);
+    CHECK(root->getGroup(2) == nullptr);
+  }
+}
+
+// Overrides of a compacted group can be edited and saved
+static void testTemplate(){
+  // children that an override cannot describe are left as they are
+  std::shared_ptr<Group> lossy = timeSeries(3, false);
+  lossy->getGroups()[1]->attributes.clear();
+  CHECK(lossy->compactToTemplate() == 1);
+  CHECK(lossy->getTemplateGroup() == nullptr && lossy->getGroups().size() == 3);
+  CHECK(lossy->getGroups()[1]->attributes.empty());
+  lossy->getGroups()[1]->setAttribute("step", "1");
+  lossy->getGroups()[0]->addVariable("salinity", XidxDataType::NumberType::FLOAT_NUMBER_TYPE, 32);
+  CHECK(lossy->compactToTemplate() == 1);
+  CHECK(lossy->getGroups()[1]->getVariables().size() == 2);
+  
+  std::shared_ptr<Group> root = timeSeries(6, false);
+  std::static_pointer_cast<SpatialDomain>(root->getGroups()[3]->getDomain())->SetGeometry(
+    Geometry::GeometryType::RECT_GEOMETRY_TYPE, 3, std::vector<double>{0, 2, 0, 2, 0, 2}.data());
+  root->getGroups()[2]->addVariable("salinity", XidxDataType::NumberType::FLOAT_NUMBER_TYPE, 32);
+  
+  CHECK(root->compactToTemplate() == 0);
+  CHECK(root->getTemplateGroup() != nullptr);
+  CHECK(root->addGroup(timeStep(6)) == 1);
+  for(int t=0; t < 6; t++)
+    CHECK(stepOf(root->getGroup(t)) == t);
+  
+  // the elements moved into the overrides belong to them now
+  for(auto& o: root->getOverrides()){
+    std::shared_ptr<Group> delta = o.second;
+    if(delta->getDomain() != nullptr){
+      CHECK(delta->getDomain()->getParent() == delta.get());
+      delta->getDomain()->addAttribute("edited", "domain");
+    }
+    for(auto& v: delta->getVariables()){
+      CHECK(v->getParent() == delta.get());
+      v->addAttribute("edited", "variable");
+    }
+  }
+  
+  MetadataFile meta("template.xidx");
+  meta.setRootGroup(root);
+  CHECK(meta.save() == 0);
+  
+  MetadataFile loaded("template.xidx");
+  CHECK(loaded.Load() == 0);
+  root = loaded.getRootGroup();
+  CHECK(root->getTemplateGroup() != nullptr);
+  for(int t=0; t < 6; t++){
+    std::shared_ptr<Group> g = root->getGroup(t);
+    CHECK(stepOf(g) == t);
+    CHECK(g->getVariables().size() == (t == 2 ? 3u : 2u));
+  }
+  
+  std::shared_ptr<Variable> salinity = variableOf(root->getGroup(2), "salinity");
+  CHECK(salinity != nullptr && salinity->getAttributes().size() == 1 &&
+        salinity->getAttributes()[0]->value == "variable");
+  
+  std::shared_ptr<Domain> edited = root->getGroup(3)->getDomain();
+  CHECK(edited->getAttributes().size() == 1 && edited->getAttributes()[0]->value == "domain");
+  CHECK(root->getGroup(4)->getDomain()->getAttributes().empty());
+}
+
+// The values of a list are read up to its Dimensions
+static void testListDimensions(){
+  MetadataFile meta("list.xidx");
+  meta.setRootGroup(timeSeries(5, false));
+  CHECK(meta.save() == 0);
+  
+  std::string xml = readFile("list.xidx");
+  CHECK(replaceOnce(xml, "Dimensions=\"5\"", "Dimensions=\"3\""));
+  CHECK(writeFile("list_3.xidx", xml) == 0);
+  
+  MetadataFile shorter("list_3.xidx");
+  CHECK(shorter.Load() == 0);
+  CHECK(shorter.getRootGroup()->getDomain()->getLinearizedIndexSpace() == (IndexSpace{0, 1, 2}));
+  
+  meta.setRootGroup(timeSeries(5, true));
+  CHECK(meta.save() == 0);
+  
+  xml = readFile("list.xidx");
+  CHECK(replaceOnce(xml, "Dimensions=\"5 2\"", "Dimensions=\"2 2\""));
+  CHECK(writeFile("list_2x2.xidx", xml) == 0);
+  
+  MetadataFile pairs("list_2x2.xidx");
+  CHECK(pairs.Load() == 0);
+  CHECK(pairs.getRootGroup()->getDomain()->getLinearizedIndexSpace() == (IndexSpace{0, 0.5, 1, 1.5}));
+}
+
+// A compacted list reads back the same values, bit for bit
+static void testCompactLists(){
+  std::vector<double> exact, accumulated;
+  double t = 0;
+  for(int i=0; i < 1000; i++, t += 0.1){
+    exact.push_back(2.0*i);
+    accumulated.push_back(t);
+  }
+  
+  for(int accumulate=0; accumulate < 2; accumulate++){
+    const std::vector<double>& values = accumulate ? accumulated : exact;
+    std::shared_ptr<Group> root(new Group("TimeSeries", Group::GroupType::TEMPORAL_GROUP_TYPE));
+    std::shared_ptr<TemporalListDomain> time(new TemporalListDomain("Time"));
+    time->setCompactOnSave(true);
+    for(auto v: values)
+      time->addDomainItem(v);
+    root->setDomain(time);
+    
+    MetadataFile meta("compact.xidx");
+    meta.setRootGroup(root);
+    CHECK(meta.save() == 0);
+    
+    MetadataFile loaded("compact.xidx");
+    CHECK(loaded.Load() == 0);
+    CHECK(loaded.getRootGroup()->getDomain()->getLinearizedIndexSpace() == values);
+    
+    // the exact progression is written as a single run
+    if(!accumulate)
+      CHECK(readFile("compact.xidx").find("HyperSlab") != std::string::npos);
+  }
+}
+
+// Children that differ by their box and data source are kept in a table
+static void testTable(){
+  MetadataFile meta("table.xidx");
+  meta.setRootGroup(tiledSeries(5));
+  CHECK(meta.getRootGroup()->compactToTable() == 0);
+  CHECK(meta.save() == 0);
+  
+  MetadataFile loaded("table.xidx");
+  CHECK(loaded.Load() == 0);
+  std::shared_ptr<Group> root = loaded.getRootGroup();
+  CHECK(root->getTable() != nullptr && root->getTable()->getNumberOfRows() == 5);
+  for(int t=0; t < 5; t++){
+    std::shared_ptr<Group> g = root->getGroup(t);
+    const std::vector<double>& box = std::static_pointer_cast<SpatialDomain>(g->getDomain())->geometry.items[0].getValues();
+    CHECK(box.size() == 6 && box[0] == t && box[1] == t+1);
+    CHECK(g->data_sources[0]->getUrl() == "tile_" + std::to_string(t) + ".idx");
+  }
+  CHECK(root->getTable()->getGeometry(5, 0).empty());
+  CHECK(root->getTable()->getGeometry(0, 1).empty());
+  
+  // a table whose columns do not have all the rows is dropped
+  std::string xml = readFile("table.xidx");
+  CHECK(replaceOnce(xml, "Rows=\"5\"", "Rows=\"7\""));
+  CHECK(writeFile("table_bad.xidx", xml) == 0);
+  
+  MetadataFile bad("table_bad.xidx");
+  CHECK(bad.Load() == 0);
+  CHECK(bad.getRootGroup()->getTable() == nullptr);
+  CHECK(bad.getRootGroup()->getGroup(6) == bad.getRootGroup()->getTemplateGroup());
+}
+
+// A save in progress writes the tree as it was when requested
+static void testSaveAsync(){
+  std::shared_ptr<Group> root = tiledSeries(4);
+  CHECK(root->compactToTable() == 0);
+  std::shared_ptr<Group> tile = root->getTemplateGroup();
+  std::shared_ptr<Variable> temperature = variableOf(tile, "temperature");
+  temperature->addAttribute(std::make_shared<Attribute>("units", "K"));
+  tile->getDomain()->addAttribute("frame", "local");
+  
+  MetadataFile meta("async.xidx");
+  meta.setRootGroup(root);
+  std::future<int> first = meta.saveAsync();
+  
+  // edits made while the save runs
+  temperature->getAttributes()[0]->setValue("C");
+  tile->getDomain()->getAttributes()[0]->setValue("global");
+  CHECK(root->getTable()->addRow({4, 5, 0, 1, 0, 1}, "tile_4.idx") == 0);
+  CHECK(first.get() == 0);
+  
+  std::string saved = readFile("async.xidx");
+  CHECK(saved.find("Value=\"K\"") != std::string::npos && saved.find("Value=\"C\"") == std::string::npos);
+  CHECK(saved.find("Value=\"local\"") != std::string::npos);
+  CHECK(saved.find("Rows=\"4\"") != std::string::npos);
+  
+  // the edits are not hidden by the previous snapshot
+  CHECK(meta.saveAsync().get() == 0);
+  MetadataFile loaded("async.xidx");
+  CHECK(loaded.Load() == 0);
+  root = loaded.getRootGroup();
+  CHECK(root->getTable() != nullptr && root->getTable()->getNumberOfRows() == 5);
+  CHECK(root->getGroup(4)->data_sources[0]->getUrl() == "tile_4.idx");
+  temperature = variableOf(root->getTemplateGroup(), "temperature");
+  CHECK(temperature->getAttributes().size() == 1 && temperature->getAttributes()[0]->value == "C");
+  CHECK(root->getTemplateGroup()->getDomain()->getAttributes()[0]->value == "global");
+}
+
+// A parallel load builds the tree of a serial one, sharing included
+static void testParallelLoad(){
+  MetadataFile meta("parallel.xidx");
+  meta.setRootGroup(timeSeries(8, false));
+  CHECK(meta.save() == 0);
+  
+  std::string serial_buffer, parallel_buffer;
+  MetadataFile serial("parallel.xidx");
+  CHECK(serial.Load() == 0);
+  CHECK(serial.serializeToBuffer(serial_buffer) == 0);
+  
+  MetadataFile parallel("parallel.xidx");
+  parallel.setParallelLoad(true);
+  parallel.setShareOnLoad(true);
+  CHECK(parallel.Load() == 0);
+  CHECK(parallel.serializeToBuffer(parallel_buffer) == 0);
+  CHECK(parallel_buffer == serial_buffer);
+  
+  std::shared_ptr<Group> root = parallel.getRootGroup();
+  CHECK(root->getGroup(0)->getDomain() == root->getGroup(7)->getDomain());
+  CHECK(variableOf(root->getGroup(0), "pressure") == variableOf(root->getGroup(5), "pressure"));
+  
+  // an error in any child reaches the caller, as it does for a serial load
+  std::string xml = readFile("parallel.xidx");
+  const std::string dimensions = "Dimensions=\"10 20 30\"";
+  size_t pos = xml.rfind(dimensions);
+  CHECK(pos != std::string::npos);
+  xml.replace(pos, dimensions.size(), "Dimensions=\"10 x 30\"");
+  CHECK(writeFile("parallel_bad.xidx", xml) == 0);
+  
+  for(int parallel_load=0; parallel_load < 2; parallel_load++){
+    MetadataFile bad("parallel_bad.xidx");
+    bad.setParallelLoad(parallel_load != 0);
+    bool thrown = false;
+    try{
+      bad.Load();
+    }
+    catch(const std::invalid_argument&){
+      thrown = true;
+    }
+    CHECK(thrown);
+  }
+}
+
+// Appends are replayed by readers, a record cut by a crash is ignored
+static void testJournal(){
+  remove("journal.xidx.journal");
+  MetadataFile meta("journal.xidx");
+  meta.setRootGroup(timeSeries(3, false));
+  CHECK(meta.save() == 0);
+  
+  MetadataFile writer("journal.xidx");
+  CHECK(writer.Load() == 0);
+  CHECK(writer.appendGroup(writer.getRootGroup(), timeStep(3), 3.0) == 0);
+  CHECK(writer.appendGroup(writer.getRootGroup(), timeStep(4), 4.0) == 0);
+  CHECK(writer.appendAttribute(writer.getRootGroup(), "last", "4") == 0);
+  
+  MetadataFile reader("journal.xidx");
+  CHECK(reader.Load() == 0);
+  CHECK(reader.getNumberOfGroups() == 5);
+  CHECK(stepOf(reader.getRootGroup()->getGroup(4)) == 4);
+  CHECK(attributeOf(reader.getRootGroup(), "last") == "4");
+  
+  std::string journal = readFile("journal.xidx.journal");
+  CHECK(journal.size() > 3);
+  CHECK(writeFile("journal.xidx.journal", journal.substr(0, journal.size()-3)) == 0);
+  
+  MetadataFile after_crash("journal.xidx");
+  CHECK(after_crash.Load() == 0);
+  CHECK(after_crash.getNumberOfGroups() == 5);
+  CHECK(stepOf(after_crash.getRootGroup()->getGroup(4)) == 4);
+  CHECK(attributeOf(after_crash.getRootGroup(), "last") == "");
+}
+
+// A tree rebuilt from a buffer is saved as the tree it was written from
+static void testBuffer(){
+  std::shared_ptr<Group> root = timeSeries(4, true);
+  root->setAttribute("note", "a < b & c");
+  
+  MetadataFile meta("buffer.xidx");
+  meta.setRootGroup(root);
+  CHECK(meta.save() == 0);
+  
+  MetadataFile loaded("buffer.xidx");
+  CHECK(loaded.Load() == 0);
+  std::string buffer;
+  CHECK(loaded.serializeToBuffer(buffer) == 0);
+  
+  MetadataFile rebuilt("buffer_copy.xidx");
+  CHECK(rebuilt.loadFromBuffer(buffer) == 0);
+  CHECK(rebuilt.getNumberOfGroups() == 4);
+  CHECK(rebuilt.save() == 0);
+  CHECK(readFile("buffer_copy.xidx") == readFile("buffer.xidx"));
+  
+  MetadataFile truncated("buffer_truncated.xidx");
+  CHECK(truncated.loadFromBuffer(buffer.data(), buffer.size()/2) != 0);
+}
+
+// Items keep their inline text out of line and share the locks of their
+// values, decoding them from several threads at once
+static void testDataItem(){
+  Parsable* no_parent = nullptr;
+  DataItem empty(no_parent);
+  CHECK(empty.getText().empty() && empty.getMemoryUsage() == sizeof(DataItem));
+  
+  std::vector<DataItem> items(16, DataItem(no_parent));
+  for(int i=0; i < 16; i++){
+    items[i].dimensions = {3};
+    items[i].setText(std::to_string(i) + " 1 2");
+  }
+  
+  DataItem copy = items[5];
+  CHECK(copy.getText() == "5 1 2" && copy.getMemoryUsage() > sizeof(DataItem));
+  
+  std::vector<std::future<bool> > decoded;
+  for(int t=0; t < 4; t++)
+    decoded.push_back(std::async(std::launch::async, [&items](){
+      bool same = true;
+      for(int i=0; i < 16; i++)
+        same = same && items[i].getValues() == (std::vector<double>{double(i), 1, 2});
+      return same;
+    }));
+  for(auto& d: decoded)
+    CHECK(d.get());
+  
+  CHECK(items[5].getText().empty() && copy.getText() == "5 1 2");
+  copy.setValues(std::vector<double>{4, 5, 6});
+  CHECK(copy.getText().empty() && copy.getValues() == (std::vector<double>{4, 5, 6}));
+}
+
+// A tree written to a buffer keeps its templates and overrides, it loses
+// the selection, the sharing and the includes of the loaded file
+static void testBufferBackend(){
+  std::shared_ptr<Group> root = timeSeries(4, false);
+  root->getGroups()[2]->addVariable("salinity", XidxDataType::NumberType::FLOAT_NUMBER_TYPE, 32);
+  CHECK(root->compactToTemplate() == 0);
+  
+  MetadataFile meta("backend.xidx");
+  meta.setRootGroup(root);
+  std::string buffer;
+  CHECK(meta.serializeToBuffer(buffer) == 0);
+  MetadataFile rebuilt("backend_copy.xidx");
+  CHECK(rebuilt.loadFromBuffer(buffer) == 0);
+  CHECK(rebuilt.getRootGroup()->getTemplateGroup() != nullptr);
+  for(int t=0; t < 4; t++){
+    CHECK(stepOf(rebuilt.getRootGroup()->getGroup(t)) == t);
+    CHECK(rebuilt.getRootGroup()->getGroup(t)->getVariables().size() == (t == 2 ? 3u : 2u));
+  }
+  
+  meta.setRootGroup(timeSeries(4, false));
+  CHECK(meta.save() == 0);
+  MetadataFile shared("backend.xidx");
+  shared.setShareOnLoad(true);
+  CHECK(shared.LoadTimeRange(0.9, 2.1) == 0);
+  CHECK(shared.getRootGroup()->getGroup(1)->getDomain() == shared.getRootGroup()->getGroup(2)->getDomain());
+  
+  CHECK(shared.serializeToBuffer(buffer) == 0);
+  CHECK(rebuilt.loadFromBuffer(buffer) == 0);
+  std::shared_ptr<Group> copy = rebuilt.getRootGroup();
+  CHECK(copy->isPartiallyLoaded() && copy->getGroups().size() == 2);
+  CHECK(copy->getGroup(0) == nullptr && copy->getGroup(3) == nullptr);
+  CHECK(stepOf(copy->getGroup(1)) == 1 && stepOf(copy->getGroup(2)) == 2);
+  CHECK(copy->getGroup(1)->getDomain() != copy->getGroup(2)->getDomain());
+}
+
+// A subtree found under the key of another one is not shared, keys are
+// only hashes
+static void testSubtreeTable(){
+  MetadataFile meta("subtree.xidx");
+  meta.setRootGroup(timeSeries(2, false));
+  CHECK(meta.save() == 0);
+  
+  xmlDocPtr doc = xmlReadFile("subtree.xidx", NULL, 0);
+  CHECK(doc != NULL);
+  std::vector<xmlNodePtr> grids;
+  for(xmlNodePtr n = xmlDocGetRootElement(doc)->children; n != NULL; n = n->next)
+    if(elementOf(n) == Element::GROUP_ELEMENT)
+      for(xmlNodePtr c = n->children; c != NULL; c = c->next)
+        if(elementOf(c) == Element::GROUP_ELEMENT)
+          grids.push_back(c);
+  CHECK(grids.size() == 2);
+  
+  // the domain of the first step stands for a different one with its key
+  std::shared_ptr<SpatialDomain> forged(new SpatialDomain("Grid"));
+  double box[6] = {0, 9, 0, 9, 0, 9};
+  forged->SetGeometry(Geometry::GeometryType::RECT_GEOMETRY_TYPE, 3, box);
+  SubtreeTable table;
+  for(xmlNodePtr c = grids[0]->children; c != NULL; c = c->next)
+    if(elementOf(c) == Element::DOMAIN_ELEMENT)
+      table.insert(SubtreeTable::keyOf(c, ""), forged);
+  
+  std::shared_ptr<Group> first(new Group(""));
+  first->setSubtreeTable(&table);
+  CHECK(first->deserialize(grids[0], nullptr) == 0);
+  CHECK(first->getDomain() != forged && first->getDomain()->getAttributes().empty());
+  CHECK(std::static_pointer_cast<SpatialDomain>(first->getDomain())->geometry.items[0].getValues() ==
+        (std::vector<double>{0, 1, 0, 1, 0, 1}));
+  
+  // equal subtrees are still shared
+  SubtreeTable shared;
+  std::shared_ptr<Group> steps[2] = {std::make_shared<Group>(""), std::make_shared<Group>("")};
+  for(int t=0; t < 2; t++){
+    steps[t]->setSubtreeTable(&shared);
+    CHECK(steps[t]->deserialize(grids[t], nullptr) == 0);
+  }
+  CHECK(steps[0]->getDomain() == steps[1]->getDomain());
+  CHECK(steps[0]->getVariables()[0] == steps[1]->getVariables()[0]);
+  xmlFreeDoc(doc);
+}
+
+// Attributes with entity references are merged into values kept with their
+// document, which a DocumentReader never modifies
+static void testMergedProp(){
+  const char* xml = "<!DOCTYPE Xidx [<!ENTITY unit \"kelvin\">]>\n"
+                    "<Xidx><Attribute Name=\"unit\" Value=\"in &unit; degrees\"/></Xidx>\n";
+  CHECK(writeFile("merged.xidx", xml) == 0);
+  
+  {
+    DocumentReader reader;
+    xmlDocPtr doc = reader.read("merged.xidx", 0);
+    CHECK(doc != NULL);
+    xmlNodePtr att = xmlDocGetRootElement(doc)->children;
+    while(att != NULL && att->type != XML_ELEMENT_NODE)
+      att = att->next;
+    CHECK(att != NULL && att->properties->next->children->next != NULL);
+    
+    const char* value = getProp(att, "Value");
+    CHECK(value != NULL && strcmp(value, "in kelvin degrees") == 0);
+    CHECK(getProp(att, "Value") == value);
+    CHECK(att->properties->next->children->next != NULL);
+  }
+  
+  xmlDocPtr doc = xmlReadMemory(xml, (int)strlen(xml), NULL, NULL, 0);
+  CHECK(doc != NULL);
+  xmlNodePtr att = xmlDocGetRootElement(doc)->children;
+  const char* value = getProp(att, "Value");
+  CHECK(value != NULL && strcmp(value, "in kelvin degrees") == 0);
+  CHECK(att->properties->next->children->next == NULL && getProp(att, "Value") == value);
+  xmlFreeDoc(doc);
+}
+
+// Extents beyond 32 bits are kept, volumes that do not fit are reported
+static void testExtents(){
+  IndexVector dims{10, 20, 30};
+  CHECK(!dims.isWide() && volumeOf(dims) == 6000);
+  dims.push_back(5000000000ULL);
+  CHECK(dims.isWide() && dims[3] == 5000000000ULL && dims[0] == 10);
+  CHECK(volumeOf(IndexVector{3000000000ULL, 2}) == 6000000000ULL);
+  CHECK(volumeOf(IndexVector{1ULL << 32, 1ULL << 32}) == 0);
+  
+  size_t volume = 1ULL << 40;
+  CHECK(!multiplyVolume(volume, 1ULL << 30) && volume == (1ULL << 40));
+  
+  std::shared_ptr<Group> root(new Group("Grid"));
+  std::shared_ptr<SpatialDomain> domain(new SpatialDomain("Grid"));
+  INDEX_TYPE extents[3] = {5000000000ULL, 7, 1};
+  domain->setTopology(Topology::TopologyType::CORECT_3D_MESH_TOPOLOGY_TYPE, 3, extents);
+  root->setDomain(domain);
+  
+  MetadataFile meta("extents.xidx");
+  meta.setRootGroup(root);
+  CHECK(meta.save() == 0);
+  MetadataFile loaded("extents.xidx");
+  CHECK(loaded.Load() == 0);
+  std::shared_ptr<SpatialDomain> read = std::static_pointer_cast<SpatialDomain>(loaded.getRootGroup()->getDomain());
+  CHECK(read->topology.dimensions == (IndexVector{5000000000ULL, 7, 1}));
+}
+
+// Every name of an enumeration parses back to its value, other strings
+// leave the value as it is
+template<typename E>
+static bool sameNames(int first, int last, const char* (*to_string)(E), bool (*from_string)(const char*, E&)){
+  for(int i=first; i <= last; i++){
+    E v = E(i == first ? last : first);
+    if(!from_string(to_string(E(i)), v) || v != E(i))
+      return false;
+  }
+  
+  E v = E(first);
+  std::string longer = std::string(to_string(E(last))) + "s";
+  return !from_string("[Unknown]", v) && !from_string(longer.c_str(), v) &&
+    !from_string(nullptr, v) && v == E(first);
+}
+
+static void testNames(){
+  CHECK(sameNames(XidxDataType::CHAR_NUMBER_TYPE, XidxDataType::UINT_NUMBER_TYPE,
+                  XidxDataType::toString, XidxDataType::fromString));
+  CHECK(sameNames(Variability::STATIC_VARIABILITY_TYPE, Variability::OVERRIDE_VARIABILITY_TYPE,
+                  Variability::toString, Variability::fromString));
+  CHECK(sameNames(Group::SPATIAL_GROUP_TYPE, Group::TEMPORAL_GROUP_TYPE, Group::toString, Group::fromString));
+  CHECK(sameNames(Variable::NODE_CENTER, Variable::EDGE_CENTER, Variable::toString, Variable::fromString));
+  CHECK(sameNames(Domain::HYPER_SLAB_DOMAIN_TYPE, Domain::RANGE_DOMAIN_TYPE, Domain::toString, Domain::fromString));
+  CHECK(sameNames(Endianess::LITTLE_ENDIANESS, Endianess::NATIVE_ENDIANESS, Endianess::toString, Endianess::fromString));
+  CHECK(sameNames(DataItem::XML_FORMAT, DataItem::IDX_FORMAT, DataItem::toString, DataItem::fromString));
+  CHECK(sameNames(Geometry::XYZ_GEOMETRY_TYPE, Geometry::RECT_GEOMETRY_TYPE, Geometry::toString, Geometry::fromString));
+  CHECK(sameNames(Topology::NO_TOPOLOGY_TYPE, Topology::DIM_1D_TOPOLOGY_TYPE, Topology::toString, Topology::fromString));
+  CHECK(sameNames<Encoding::EncodingType>(Encoding::TEXT_ENCODING, Encoding::BIT_PACKED_ENCODING, Encoding::toString, Encoding::fromString));
+  CHECK(sameNames<Encoding::CompressionType>(Encoding::NO_COMPRESSION, Encoding::ZLIB_COMPRESSION, Encoding::toString, Encoding::fromString));
+  CHECK(sameNames(Element::XIDX_ELEMENT, Element::INCLUDE_ELEMENT, Element::toString, Element::fromString));
+  
+  xmlNodePtr node = xmlNewNode(NULL, BAD_CAST "Group");
+  CHECK(elementOf(node) == Element::GROUP_ELEMENT);
+  xmlNodeSetName(node, BAD_CAST "group");
+  CHECK(elementOf(node) == Element::UNKNOWN_ELEMENT);
+  xmlFreeNode(node);
+}
+
+// Files are read again after cleanup, by the threads that read them before
+static void testLibrary(){
+  MetadataFile meta("library.xidx");
+  meta.setRootGroup(timeSeries(8, false));
+  CHECK(meta.save() == 0);
+  
+  for(int round=0; round < 2; round++){
+    MetadataFile loaded("library.xidx");
+    loaded.setParallelLoad(true);
+    CHECK(loaded.Load() == 0);
+    for(int t=0; t < 8; t++)
+      CHECK(stepOf(loaded.getRootGroup()->getGroup(t)) == t);
+    
+    std::future<size_t> other = std::async(std::launch::async, [](){
+      MetadataFile again("library.xidx");
+      return again.Load() == 0 ? again.getNumberOfGroups() : 0;
+    });
+    CHECK(other.get() == 8);
+    
+    Library::cleanup();
+    Library::cleanup();
+  }
+  
+  CHECK(Library::parserContext() != NULL);
+}
+
+// n steps written to subfiles of the given pattern, e.g. "step_%d"
+static std::shared_ptr<Group> filedSeries(int n, const std::string& pattern){
+  std::shared_ptr<Group> root(new Group("TimeSeries", Group::GroupType::TEMPORAL_GROUP_TYPE, pattern));
+  std::shared_ptr<TemporalListDomain> time(new TemporalListDomain("Time"));
+  for(int t=0; t < n; t++)
+    time->addDomainItem(double(t));
+  root->setDomain(time);
+  root->addDataSource(std::make_shared<DataSource>("data", "data.idx"));
+  
+  for(int t=0; t < n; t++)
+    root->addGroup(timeStep(t));
+  return root;
+}
+
+// An incremental save writes only the changed children and the same bytes
+// as a full save
+static void testIncrementalSave(){
+  for(int filed=0; filed < 2; filed++){
+    MetadataFile meta("incremental.xidx");
+    meta.setIncrementalSave(true);
+    meta.setRootGroup(filed ? filedSeries(4, "incremental_%d") : timeSeries(4, false));
+    CHECK(meta.save() == 0);
+    
+    std::shared_ptr<Group> root = meta.getRootGroup();
+    CHECK(!root->isModified() && !root->getGroup(1)->isModified());
+    root->getGroup(2)->setAttribute("step", "two");
+    CHECK(root->isModified() && root->getGroup(2)->isModified() && !root->getGroup(1)->isModified());
+    
+    // an unchanged subfile is left as it is
+    if(filed)
+      CHECK(writeFile("incremental_1/meta.xidx", "unchanged") == 0);
+    CHECK(meta.save() == 0);
+    CHECK(!root->isModified());
+    if(filed){
+      CHECK(readFile("incremental_1/meta.xidx") == "unchanged");
+      CHECK(readFile("incremental_2/meta.xidx").find("two") != std::string::npos);
+    }
+    
+    std::string incremental = readFile("incremental.xidx");
+    MetadataFile full("incremental.xidx");
+    full.setRootGroup(root);
+    CHECK(full.save() == 0);
+    CHECK(readFile("incremental.xidx") == incremental);
+    
+    MetadataFile loaded("incremental.xidx");
+    CHECK(loaded.Load() == 0);
+    CHECK(attributeOf(loaded.getRootGroup()->getGroup(1), "step") == "1");
+    CHECK(attributeOf(loaded.getRootGroup()->getGroup(2), "step") == "two");
+  }
+}
+
+// A parallel save writes the same bytes as a serial one
+static void testParallelSave(){
+  for(int filed=0; filed < 2; filed++){
+    std::shared_ptr<Group> root = filed ? filedSeries(6, "parallel_%d") : timeSeries(6, true);
+    root->getGroups()[3]->addVariable("salinity", XidxDataType::NumberType::FLOAT_NUMBER_TYPE, 32);
+    
+    std::string files[2], subfiles[2];
+    for(int parallel=0; parallel < 2; parallel++){
+      MetadataFile meta("parallel_save.xidx");
+      meta.setParallelSave(parallel != 0);
+      meta.setRootGroup(root);
+      CHECK(meta.save() == 0);
+      files[parallel] = readFile("parallel_save.xidx");
+      if(filed)
+        subfiles[parallel] = readFile("parallel_3/meta.xidx");
+    }
+    
+    CHECK(files[0].size() > 0 && files[0] == files[1]);
+    CHECK(subfiles[0] == subfiles[1]);
+    if(filed)
+      CHECK(subfiles[0].find("salinity") != std::string::npos);
+  }
+}
+
+// Children outside the selection are read on demand, ahead of a sequential
+// walk, and a change of stride drops the ones read ahead
+static void testPrefetch(){
+  MetadataFile meta("prefetch.xidx");
+  meta.setRootGroup(filedSeries(12, "prefetch_%d"));
+  CHECK(meta.save() == 0);
+  
+  MetadataFile loaded("prefetch.xidx");
+  CHECK(loaded.LoadTimeRange(-0.1, 0.1) == 0);
+  std::shared_ptr<Group> root = loaded.getRootGroup();
+  CHECK(root->isPartiallyLoaded() && root->getGroup(1) == nullptr);
+  
+  CHECK(root->setPrefetch(3) == 0);
+  for(int t=1; t < 8; t++){
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(stepOf(root->getGroup(t)) == t);
+  }
+  std::shared_ptr<GroupPrefetcher> prefetcher = root->getPrefetcher();
+  CHECK(prefetcher->getNumberOfHits() >= 4);
+  
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  size_t cancellations = prefetcher->getNumberOfCancellations();
+  CHECK(stepOf(root->getGroup(11)) == 11);
+  CHECK(prefetcher->getNumberOfCancellations() == cancellations + 1);
+  CHECK(root->getGroup(4) == root->getGroup(4));
+  
+  CHECK(root->setPrefetch(0) == 0);
+  CHECK(root->getPrefetcher() == nullptr && root->getGroup(10) == nullptr);
+}
+
+// Children read on demand are kept within the budget of the cache, the
+// least recently used are evicted and read again
+static void testCache(){
+  MetadataFile meta("cache.xidx");
+  meta.setRootGroup(filedSeries(6, "cache_%d"));
+  CHECK(meta.save() == 0);
+  
+  MetadataFile loaded("cache.xidx");
+  CHECK(loaded.setCacheBudget(1 << 20) == 0);
+  CHECK(loaded.LoadTimeRange(-0.1, 0.1) == 0);
+  std::shared_ptr<Group> root = loaded.getRootGroup();
+  std::shared_ptr<GroupCache> cache = loaded.getCache();
+  
+  std::shared_ptr<Group> first = root->getGroup(1);
+  CHECK(stepOf(first) == 1 && root->getGroup(1) == first);
+  CHECK(cache->getNumberOfMisses() == 1 && cache->getNumberOfHits() == 1);
+  CHECK(root->getGroups().size() == 1);
+  
+  size_t entry = cache->getSize();
+  CHECK(entry > 0);
+  CHECK(loaded.setCacheBudget(2*entry + entry/2) == 0);
+  for(int t=2; t < 6; t++)
+    CHECK(stepOf(root->getGroup(t)) == t);
+  CHECK(cache->getNumberOfEntries() == 2 && cache->getSize() <= cache->getBudget());
+  CHECK(cache->getNumberOfEvictions() == 3);
+  
+  std::shared_ptr<Group> again = root->getGroup(1);
+  CHECK(stepOf(again) == 1 && again != first);
+  CHECK(cache->getNumberOfMisses() == 6);
+}
+
+// A range is written as its bounds, children are selected by their value
+// in a stepped range and by their part of a continuous one
+static void testRange(){
+  for(int stepped=0; stepped < 2; stepped++){
+    std::shared_ptr<Group> root(new Group("TimeSeries", Group::GroupType::TEMPORAL_GROUP_TYPE));
+    std::shared_ptr<RangeDomain> range(new RangeDomain("Time"));
+    CHECK(range->setRange(5, 1) != 0);
+    CHECK(range->setRange(0, 10, stepped ? 2 : 0) == 0);
+    root->setDomain(range);
+    for(int t=0; t < 5; t++)
+      root->addGroup(timeStep(t));
+    
+    CHECK(range->contains(10) && !range->contains(10.5) && range->clamp(-1) == 0);
+    if(stepped)
+      CHECK(range->getNumberOfIndices() == 6 && range->getValue(3) == 6 && range->getIndex(6.9) == 3);
+    
+    MetadataFile meta("range.xidx");
+    meta.setRootGroup(root);
+    CHECK(meta.save() == 0);
+    CHECK(readFile("range.xidx").find(stepped ? ">0 10 2<" : ">0 10<") != std::string::npos);
+    
+    MetadataFile loaded("range.xidx");
+    CHECK(loaded.LoadTimeRange(4.5, 5.5) == 0);
+    std::shared_ptr<Group> read = loaded.getRootGroup();
+    std::shared_ptr<RangeDomain> read_range = std::dynamic_pointer_cast<RangeDomain>(read->getDomain());
+    CHECK(read_range != nullptr && read_range->getMax() == 10 && read_range->getStep() == (stepped ? 2 : 0));
+    
+    // no value of the stepped range falls in [4.5, 5.5], child 2 covers [4, 6]
+    for(int t=0; t < 5; t++)
+      CHECK((read->getGroup(t) != nullptr) == (!stepped && t == 2));
+    
+    MetadataFile around("range.xidx");
+    CHECK(around.LoadTimeRange(3.5, 6.5) == 0);
+    for(int t=0; t < 5; t++){
+      bool selected = stepped ? (t == 2 || t == 3) : (t >= 1 && t <= 3);
+      CHECK((around.getRootGroup()->getGroup(t) != nullptr) == selected);
+    }
+  }
+}
+
+// Large inline arrays decoded on the pool give the values of a serial parse
+static void testParallelDecode(){
+  std::string text;
+  for(int i=0; i < 20000; i++)
+    text += std::to_string(i*0.5) + (i % 7 ? " " : "\n");
+  CHECK(text.size() > XIDX_PARALLEL_DECODE_THRESHOLD);
+  
+  std::vector<double> serial, parallel;
+  CHECK(decodeTextValues(text.c_str(), serial) == 20000);
+  CHECK(decodeTextValuesParallel(text.c_str(), text.size(), parallel) == 20000);
+  CHECK(parallel == serial && serial[19999] == 9999.5);
+  
+  // chunks of the streaming decoder split numbers anywhere
+  std::vector<double> streamed;
+  TextValuesDecoder decoder;
+  for(size_t pos=0; pos < text.size(); pos += 777)
+    decoder.feed(text.data() + pos, std::min<size_t>(777, text.size() - pos), streamed);
+  decoder.finish(streamed);
+  CHECK(streamed == serial);
+  
+  // a token that is not a plain number ends the values as it does serially
+  std::string odd = text;
+  odd.replace(odd.size()/2, 1, " 0x10 ");
+  serial.clear();
+  parallel.clear();
+  decodeTextValues(odd.c_str(), serial);
+  decodeTextValuesParallel(odd.c_str(), odd.size(), parallel);
+  CHECK(parallel == serial && serial.size() < 20000);
+  
+  // threads reading the item at once see the same values
+  Parsable* no_parent = nullptr;
+  DataItem item(no_parent);
+  item.dimensions = {20000};
+  item.setText(text);
+  std::vector<std::future<bool> > readers;
+  for(int t=0; t < 4; t++)
+    readers.push_back(std::async(std::launch::async, [&item, &streamed](){ return item.getValues() == streamed; }));
+  for(auto& r: readers)
+    CHECK(r.get());
+}
+
+// Arrays past the threshold are decoded while the document is parsed and
+// never kept as text, smaller ones are kept as text until accessed
+static void testStreamDecode(){
+  std::shared_ptr<Group> root = timeSeries(3, false);
+  std::shared_ptr<TemporalListDomain> time = std::static_pointer_cast<TemporalListDomain>(root->getDomain());
+  std::vector<double> expected;
+  for(int t=3; t < 20000; t++)
+    time->addDomainItem(double(t));
+  for(int t=0; t < 20000; t++)
+    expected.push_back(t);
+  
+  MetadataFile meta("stream.xidx");
+  meta.setRootGroup(root);
+  CHECK(meta.save() == 0);
+  
+  DocumentReader reader(65536);
+  xmlDocPtr doc = reader.read("stream.xidx", 0);
+  CHECK(doc != NULL);
+  int streamed = 0;
+  std::vector<xmlNodePtr> stack(1, xmlDocGetRootElement(doc));
+  while(!stack.empty()){
+    xmlNodePtr node = stack.back();
+    stack.pop_back();
+    for(xmlNodePtr c = node->children; c != NULL; c = c->next)
+      if(c->type == XML_ELEMENT_NODE)
+        stack.push_back(c);
+    
+    if(elementOf(node) == Element::DATA_ITEM_ELEMENT && node->_private != NULL){
+      streamed++;
+      CHECK(*static_cast<std::vector<double>*>(node->_private) == expected);
+      CHECK(node->children == NULL || xmlIsBlankNode(node->children));
+    }
+  }
+  CHECK(streamed == 1);
+  
+  MetadataFile loaded("stream.xidx");
+  CHECK(loaded.Load() == 0);
+  std::shared_ptr<Group> read = loaded.getRootGroup();
+  std::shared_ptr<DataItem> list = read->getDomain()->data_items[0];
+  CHECK(list->isDecoded() && list->getText().empty() && list->getValues() == expected);
+  
+  std::shared_ptr<SpatialDomain> grid = std::static_pointer_cast<SpatialDomain>(read->getGroup(1)->getDomain());
+  CHECK(!grid->geometry.items[0].isDecoded() && !grid->geometry.items[0].getText().empty());
+  CHECK(grid->geometry.items[0].getValues() == (std::vector<double>{0, 1, 0, 1, 0, 1}));
+}
+
+// Inline values are decoded on first access, values never accessed are
+// saved back as they were read
+static void testLazyDecode(){
+  MetadataFile meta("lazy.xidx");
+  meta.setRootGroup(timeSeries(3, false));
+  CHECK(meta.save() == 0);
+  
+  std::string xml = readFile("lazy.xidx");
+  CHECK(replaceOnce(xml, ">0.000000 1.000000 2.000000<", ">0.0 1.00 2e0<"));
+  CHECK(writeFile("lazy.xidx", xml) == 0);
+  
+  MetadataFile loaded("lazy.xidx");
+  CHECK(loaded.Load() == 0);
+  std::shared_ptr<TemporalListDomain> time = std::static_pointer_cast<TemporalListDomain>(loaded.getRootGroup()->getDomain());
+  DataItem& item = *time->data_items[0];
+  CHECK(!item.isDecoded() && item.getText() == "0.0 1.00 2e0");
+  
+  CHECK(loaded.save("lazy_copy.xidx") == 0);
+  CHECK(readFile("lazy_copy.xidx").find(">0.0 1.00 2e0<") != std::string::npos);
+  
+  CHECK(item.getValues() == IndexSpace({0, 1, 2}));
+  CHECK(item.isDecoded() && item.getText().empty());
+  CHECK(loaded.save("lazy_copy.xidx") == 0);
+  CHECK(readFile("lazy_copy.xidx").find(">0.0 1.00 2e0<") == std::string::npos);
+  
+  MetadataFile copy("lazy_copy.xidx");
+  CHECK(copy.Load() == 0);
+  time = std::static_pointer_cast<TemporalListDomain>(copy.getRootGroup()->getDomain());
+  CHECK(time->data_items[0]->getValues() == IndexSpace({0, 1, 2}));
+}
+
+int main(int argc, char** argv){
+  if(argc < 2){
+    fprintf(stderr, "Usage: xidx_tests <encoding|selection|template|list_dimensions|compact_lists|table|save_async|parallel_load|journal|buffer|data_item|buffer_backend|subtree_table|merged_prop|extents|names|library|incremental_save|parallel_save|prefetch|cache|range|parallel_decode|stream_decode|lazy_decode>\n");
+    return 1;
+  }
+  
+  if(strcmp(argv[1], "encoding") == 0)
+    testEncoding();
+  else if(strcmp(argv[1], "selection") == 0)
+    testSelection();
+  else if(strcmp(argv[1], "template") == 0)
+    testTemplate();
+  else if(strcmp(argv[1], "list_dimensions") == 0)
+    testListDimensions();
+  else if(strcmp(argv[1], "compact_lists") == 0)
+    testCompactLists();
+  else if(strcmp(argv[1], "table") == 0)
+    testTable();
+  else if(strcmp(argv[1], "save_async") == 0)
+    testSaveAsync();
+  else if(strcmp(argv[1], "parallel_load") == 0)
+    testParallelLoad();
+  else if(strcmp(argv[1], "journal") == 0)
+    testJournal();
+  else if(strcmp(argv[1], "buffer") == 0)
+    testBuffer();
+  else if(strcmp(argv[1], "data_item") == 0)
+    testDataItem();
+  else if(strcmp(argv[1], "buffer_backend") == 0)
+    testBufferBackend();
+  else if(strcmp(argv[1], "subtree_table") == 0)
+    testSubtreeTable();
+  else if(strcmp(argv[1], "merged_prop") == 0)
+    testMergedProp();
+  else if(strcmp(argv[1], "extents") == 0)
+    testExtents();
+  else if(strcmp(argv[1], "names") == 0)
+    testNames();
+  else if(strcmp(argv[1], "library") == 0)
+    testLibrary();
+  else if(strcmp(argv[1], "incremental_save") == 0)
+    testIncrementalSave();
+  else if(strcmp(argv[1], "parallel_save") == 0)
+    testParallelSave();
+  else if(strcmp(argv[1], "prefetch") == 0)
+    testPrefetch();
+  else if(strcmp(argv[1], "cache") == 0)
+    testCache();
+  else if(strcmp(argv[1], "range") == 0)
+    testRange();
+  else if(strcmp(argv[1], "parallel_decode") == 0)
+    testParallelDecode();
+  else if(strcmp(argv[1], "stream_decode") == 0)
+    testStreamDecode();
+  else if(strcmp(argv[1], "lazy_decode") == 0)
+    testLazyDecode();
+  else{
+    fprintf(stderr, "Unknown test %s\n", argv[1]);
+    return 1;
+  }
+  
+  return failures > 0;
+}